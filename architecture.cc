@@ -107,6 +107,10 @@ Architecture::Architecture(void)
   pcodeinjectlib = (PcodeInjectLibrary *)0;
   commentdb = (CommentDatabase *)0;
   cpool = (ConstantPool *)0;
+  jumpcache = new JumpTableCache(this);
+  protocache = new ProtoCache();
+  analysislru = new AnalysisLru();
+  analysislru->setCeiling(512*1024*1024);
   symboltab = new Database(this);
   context = (ContextDatabase *)0;
   print = PrintLanguageCapability::getDefault()->buildLanguage(this);
@@ -160,6 +164,9 @@ Architecture::~Architecture(void)
     delete commentdb;
   if (cpool != (ConstantPool *)0)
     delete cpool;
+  delete jumpcache;
+  delete protocache;
+  delete analysislru;
   if (context != (ContextDatabase *)0)
     delete context;
 }
@@ -274,6 +281,7 @@ void Architecture::clearAnalysis(Funcdata *fd)
   fd->clear();			// Clear stuff internal to function
   // Clear out any analysis generated comments
   commentdb->clearType(fd->getAddress(),Comment::warning|Comment::warningheader);
+  analysislru->touch(fd);	// Make room for the analysis to come
 }
 
 /// Symbols do not necessarily need to be available for the decompiler.
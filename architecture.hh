@@ -33,6 +33,9 @@
 #include "transform.hh"
 #include "prefersplit.hh"
 
+class JumpTableCache;
+class AnalysisLru;
+
 #ifdef CPUI_STATISTICS
 /// \brief Class for collecting statistics while processing over multiple functions
 ///
@@ -146,6 +149,9 @@ public:
   RangeList nohighptr;          ///< Ranges for which high-level pointers are not possible
   CommentDatabase *commentdb;	///< Comments for this architecture
   ConstantPool *cpool;		///< Deferred constant values
+  JumpTableCache *jumpcache;	///< Jump-tables recovered by previous decompiles
+  ProtoCache *protocache;	///< Prototypes recovered for functions by previous analysis
+  AnalysisLru *analysislru;	///< Functions holding analysis state, for evicting idle ones
   PrintLanguage *print;	        ///< Current high-level language printer
   vector<PrintLanguage *> printlist;	///< List of high-level language printers supported
   OptionDatabase *options;	///< Options that can be configured
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include "xml.hh"
 #include "ast.hh"
@@ -155,6 +156,9 @@ static map<string,string> type_map;
 
 static const string empty_string("");
 
+//statements given oprefs while the current tree is built
+static thread_local vector<Statement*> *op_statements;
+
 static void block_handler(const Element *el, Block *block);
 //static Statement *inner_block(const Element *child);
 static VarDecl *vardecl_handler(const Element *el);
@@ -240,39 +244,113 @@ static const Element *get_child(List::const_iterator &it) {
 }
 
 const char *debug_print(AstItem *exp) {
-   string l = exp->line;
-   exp->line.clear();
+   RenderContext rc;
+   RenderContext *prev = AstItem::ctx;
+   AstItem::ctx = &rc;
    exp->do_print();
-   string r = exp->line;
-   exp->line = l;
-   return tag_remove(r.c_str());
+   AstItem::ctx = prev;
+   return tag_remove(rc.text.c_str());
 }
 
 AstItem::AstItem() : no_indent(false), no_semi(false), line_begin(1),
                      line_end(1), col_start(-1), col_end(-1),
                      color(COLOR_DEFAULT) {};
 
-vector<string> *AstItem::cfunc;
-string AstItem::line;
-size_t AstItem::indent;
-size_t AstItem::line_index;
+thread_local RenderContext *AstItem::ctx;
+thread_local AstArena *AstItem::arena;
+
+RenderContext::RenderContext(size_t bytes, size_t lines) : indent(0), line_index(0), func(NULL) {
+   text.reserve(bytes);
+   line_offsets.reserve(lines + 1);
+   line_offsets.push_back(0);
+}
+
+string RenderContext::get_line(size_t i) const {
+   return text.substr(line_offsets[i], line_offsets[i + 1] - line_offsets[i]);
+}
+
+void RenderContext::get_lines(vector<string> &lines) const {
+   lines.reserve(lines.size() + num_lines());
+   for (size_t i = 0; i < num_lines(); i++) {
+      lines.push_back(get_line(i));
+   }
+}
+
+#define ARENA_CHUNK 0x10000
+
+//every node is preceded by the arena it came from so delete knows
+//whether it has anything to free
+union NodeHeader {
+   AstArena *arena;
+   uint64_t align;
+};
+
+AstArena::~AstArena() {
+   for (vector<char*>::iterator i = chunks.begin(); i != chunks.end(); i++) {
+      delete [] *i;
+   }
+}
+
+void *AstArena::alloc(size_t sz) {
+   sz = (sz + sizeof(NodeHeader) - 1) & ~(sizeof(NodeHeader) - 1);
+   if (used + sz > avail) {
+      avail = sz > ARENA_CHUNK ? sz : ARENA_CHUNK;
+      chunks.push_back(new char[avail]);
+      used = 0;
+   }
+   void *res = chunks.back() + used;
+   used += sz;
+   return res;
+}
+
+const string &AstArena::intern(const string &s) {
+   return *strings.insert(s).first;
+}
+
+void *AstItem::operator new(size_t sz) {
+   NodeHeader *hdr;
+   if (arena) {
+      hdr = (NodeHeader*)arena->alloc(sz + sizeof(NodeHeader));
+   }
+   else {
+      hdr = (NodeHeader*)::operator new(sz + sizeof(NodeHeader));
+   }
+   hdr->arena = arena;
+   return hdr + 1;
+}
+
+void AstItem::operator delete(void *ptr) {
+   if (ptr == NULL) {
+      return;
+   }
+   NodeHeader *hdr = (NodeHeader*)ptr - 1;
+   if (hdr->arena == NULL) {
+      ::operator delete(hdr);
+   }
+   //arena memory is reclaimed along with the arena
+}
+
+const string &AstItem::intern(const string &s) {
+   //nodes built outside of func_from_xml share a pool that is never freed
+   static AstArena heap_strings;
+   return arena ? arena->intern(s) : heap_strings.intern(s);
+}
 
 void AstItem::flush(bool no_indent) {
-   string spaces;
-   if (!no_indent) {
-      spaces.append(indent, ' ');
+   size_t spaces = no_indent ? 0 : ctx->indent;
+   if (spaces) {
+      ctx->text.insert(ctx->line_start(), spaces, ' ');
    }
-   if (cfunc) {
-      cfunc->push_back(spaces + line);
+   if (ctx->func) {
+      ctx->func->end_line(ctx->num_lines(), spaces);
    }
-//   dmsg("append: %s\n", cfunc->back().c_str());
-   line.clear();
-   line_index = 0;
+   ctx->line_offsets.push_back(ctx->text.size());
+   ctx->line_index = 0;
 }
 
 void AstItem::append(char ch, bool count) {
-   line.push_back(ch);
-   line_index += count ? 1 : 0;
+   ctx->text.push_back(ch);
+   ctx->line_index += count ? 1 : 0;
 }
 
 void AstItem::color_on(char tag) {
@@ -290,8 +368,8 @@ void AstItem::append(const char *v) {
 }
 
 void AstItem::append(const string &v) {
-   line.append(v);
-   line_index += v.length();
+   ctx->text.append(v);
+   ctx->line_index += v.length();
 }
 
 void AstItem::append_colored(char tag, const char *v) {
@@ -304,17 +382,33 @@ void AstItem::append_colored(char tag, const string &v) {
    color_off(tag);
 }
 
+void AstItem::append_name(const string &v) {
+   if (ctx->func) {
+      ctx->func->record_name(v, ctx->text.size() - ctx->line_start(), ctx->line_index);
+   }
+   append(v);
+}
+
+void AstItem::append_name(char tag, const string &v) {
+   color_on(tag);
+   append_name(v);
+   color_off(tag);
+}
+
 void AstItem::print_in() {
-   if (cfunc) {
-      line_begin = cfunc->size();
-      col_start = line_index;
+   if (ctx->func) {
+      line_begin = ctx->num_lines();
+      col_start = ctx->line_index;
    }
 }
 
 void AstItem::print_out() {
-   if (cfunc) {
-      line_end = cfunc->size();
-      col_end = line_index;
+   if (ctx->func) {
+      line_end = ctx->num_lines();
+      col_end = ctx->line_index;
+      if (line_begin == line_end && col_start < col_end) {
+         ctx->func->record_item(this);
+      }
    }
 }
 
@@ -327,9 +421,9 @@ void AstItem::do_print() {
 void brace_print(AstItem &item, bool final_append = true) {
    AstItem::append_colored(COLOR_SYMBOL, LBRACE);
    AstItem::flush();
-   AstItem::indent += 3;
+   AstItem::ctx->indent += 3;
    item.do_print();
-   AstItem::indent -= 3;
+   AstItem::ctx->indent -= 3;
    AstItem::append_colored(COLOR_SYMBOL, RBRACE);
    if (final_append) {
       AstItem::flush();
@@ -337,7 +431,7 @@ void brace_print(AstItem &item, bool final_append = true) {
 }
 
 void Statement::print() {
-   line += "<statement>";
+   append("<statement>");
 }
 
 void Type::print() {
@@ -350,14 +444,14 @@ void Type::print(const string &var) {
    if (is_const) {
       append_colored(COLOR_KEYWORD, "const ");
    }
-   append_colored(COLOR_KEYWORD, name);
+   append_name(COLOR_KEYWORD, name);
    if (ptr) {
       if (!is_cast) {
          append(' ');
       }
       color_on(COLOR_SYMBOL);
-      line.append(ptr, '*');
-      line_index += ptr;
+      ctx->text.append(ptr, '*');
+      ctx->line_index += ptr;
       color_off(COLOR_SYMBOL);
       need_space = false;
    }
@@ -365,7 +459,7 @@ void Type::print(const string &var) {
       if (need_space) {
          append(' ');
       }
-      append_colored(COLOR_DNAME, var);
+      append_name(COLOR_DNAME, var);
    }
    for (vector<uint32_t>::iterator i = dims.begin(); i != dims.end(); i++) {
       append_colored(COLOR_SYMBOL, LBRACKET);
@@ -379,10 +473,8 @@ void Type::print(const string &var) {
    print_out();
 }
 
-void Type::rename(const string &oldname, const string &newname) {
-   if (oldname == name) {
-      name = newname;
-   }
+void Type::index_names(NameIndex &names) {
+   names[name].push_back(&name);
 }
 
 void Expression::print() {
@@ -398,58 +490,55 @@ NameExpr::NameExpr(const string &var, bool _global) : name(var), global(_global)
 }
 
 void NameExpr::print() {
+   if (ctx->func && (global || is_extern(name))) {
+      ctx->func->record_global(name, ctx->num_lines());
+   }
    if (is_extern(name)) {
-      append_colored(COLOR_IMPNAME, name);
+      append_name(COLOR_IMPNAME, name);
    }
    else {
-      append_colored(COLOR_DNAME, name);
+      append_name(COLOR_DNAME, name);
    }
 }
 
-void NameExpr::rename(const string &oldname, const string &newname) {
-//   dmsg("NameExpr::rename %s from %s to %s\n", name.c_str(), oldname.c_str(), newname.c_str());
-   if (oldname == name) {
-      name = newname;
-   }
+void NameExpr::index_names(NameIndex &names) {
+   names[name].push_back(&name);
 }
 
 void FuncNameExpr::print() {
+   if (ctx->func) {
+      ctx->func->record_global(name, ctx->num_lines());
+   }
    if (is_extern(name)) {
-      append_colored(COLOR_IMPNAME, name);
+      append_name(COLOR_IMPNAME, name);
    }
    else if (is_library_func(name)) {
-      append_colored(COLOR_DEFAULT, name);
+      append_name(COLOR_DEFAULT, name);
    }
    else {
-      append_colored(COLOR_DEFAULT, name);
+      append_name(COLOR_DEFAULT, name);
    }
 }
 
-void FuncNameExpr::rename(const string &oldname, const string &newname) {
-   if (oldname == name) {
-      name = newname;
-   }
+void FuncNameExpr::index_names(NameIndex &names) {
+   names[name].push_back(&name);
 }
 
 void LabelExpr::print() {
-   append(label);
+   append_name(label);
 }
 
-void LabelExpr::rename(const string &oldname, const string &newname) {
-   if (oldname == label) {
-      label = newname;
-   }
+void LabelExpr::index_names(NameIndex &names) {
+   names[label].push_back(&label);
 }
 
 void LabelStatement::print() {
-   line += label;
+   append_name(label);
    append_colored(COLOR_SYMBOL, COLON);
 }
 
-void LabelStatement::rename(const string &oldname, const string &newname) {
-   if (oldname == label) {
-      label = newname;
-   }
+void LabelStatement::index_names(NameIndex &names) {
+   names[label].push_back(&label);
 }
 
 void GotoStatement::print() {
@@ -458,8 +547,8 @@ void GotoStatement::print() {
    label->do_print();
 }
 
-void GotoStatement::rename(const string &oldname, const string &newname) {
-   label->rename(oldname, newname);
+void GotoStatement::index_names(NameIndex &names) {
+   label->index_names(names);
 }
 
 void BreakStatement::print() {
@@ -474,8 +563,8 @@ void ExprStatement::print() {
    expr->do_print();
 }
 
-void ExprStatement::rename(const string &oldname, const string &newname) {
-   expr->rename(oldname, newname);
+void ExprStatement::index_names(NameIndex &names) {
+   expr->index_names(names);
 }
 
 CommaExpr::~CommaExpr() {
@@ -490,9 +579,9 @@ void CommaExpr::print() {
    rhs->do_print();
 }
 
-void CommaExpr::rename(const string &oldname, const string &newname) {
-   lhs->rename(oldname, newname);
-   rhs->rename(oldname, newname);
+void CommaExpr::index_names(NameIndex &names) {
+   lhs->index_names(names);
+   rhs->index_names(names);
 }
 
 void BinaryExpr::print() {
@@ -503,9 +592,9 @@ void BinaryExpr::print() {
    rhs->do_print();
 }
 
-void BinaryExpr::rename(const string &oldname, const string &newname) {
-   lhs->rename(oldname, newname);
-   rhs->rename(oldname, newname);
+void BinaryExpr::index_names(NameIndex &names) {
+   lhs->index_names(names);
+   rhs->index_names(names);
 }
 
 void UnaryExpr::print() {
@@ -513,8 +602,8 @@ void UnaryExpr::print() {
    expr->do_print();
 }
 
-void UnaryExpr::rename(const string &oldname, const string &newname) {
-   expr->rename(oldname, newname);
+void UnaryExpr::index_names(NameIndex &names) {
+   expr->index_names(names);
 }
 
 CastExpr::CastExpr(const string &typ) {
@@ -530,8 +619,8 @@ void CastExpr::print() {
    type->do_print();
 }
 
-void CastExpr::rename(const string &oldname, const string &newname) {
-   type->rename(oldname, newname);
+void CastExpr::index_names(NameIndex &names) {
+   type->index_names(names);
 }
 
 void TypeCast::print() {
@@ -539,9 +628,9 @@ void TypeCast::print() {
    expr->do_print();
 }
 
-void TypeCast::rename(const string &oldname, const string &newname) {
-   type->rename(oldname, newname);
-   expr->rename(oldname, newname);
+void TypeCast::index_names(NameIndex &names) {
+   type->index_names(names);
+   expr->index_names(names);
 }
 
 void IntegerLiteral::print() {
@@ -574,10 +663,9 @@ void ParenExpr::print() {
    append_colored(COLOR_SYMBOL, RPAREN);
 }
 
-void ParenExpr::rename(const string &oldname, const string &newname) {
+void ParenExpr::index_names(NameIndex &names) {
    if (inner) {
-//      dmsg("ParenExpr::rename from %s to %s\n", oldname.c_str(), newname.c_str());
-      inner->rename(oldname, newname);
+      inner->index_names(names);
    }
 }
 
@@ -588,9 +676,9 @@ void ArrayExpr::print() {
    append_colored(COLOR_SYMBOL, RBRACKET);
 }
 
-void ArrayExpr::rename(const string &oldname, const string &newname) {
-   array->rename(oldname, newname);
-   index->rename(oldname, newname);
+void ArrayExpr::index_names(NameIndex &names) {
+   array->index_names(names);
+   index->index_names(names);
 }
 
 void Block::print() {
@@ -615,12 +703,11 @@ Block::~Block() {
    }
 }
 
-void Block::rename(const string &oldname, const string &newname) {
+void Block::index_names(NameIndex &names) {
    for (vector<Statement*>::iterator i = block.begin(); i != block.end(); i++) {
       Statement *s = *i;
       if (s) {
-//         dmsg("Block::rename from %s to %s\n", oldname.c_str(), newname.c_str());
-         s->rename(oldname, newname);
+         s->index_names(names);
       }
    }
 }
@@ -656,11 +743,11 @@ const string &VarDecl::getName() {
    }
 }
 
-void VarDecl::rename(const string &oldname, const string &newname) {
-   type->rename(oldname, newname);
-   var->rename(oldname, newname);
+void VarDecl::index_names(NameIndex &names) {
+   type->index_names(names);
+   var->index_names(names);
    if (init) {
-      init->rename(oldname, newname);
+      init->index_names(names);
    }
 }
 
@@ -677,7 +764,7 @@ void Funcproto::print() {
       append(*i);
    }
    append(' ');
-   append(name);
+   append_name(name);
    append_colored(COLOR_SYMBOL, LPAREN);
    for (vector<VarDecl*>::iterator i = parameters.begin(); i != parameters.end(); i++) {
       if (i != parameters.begin()) {
@@ -689,13 +776,11 @@ void Funcproto::print() {
    append_colored(COLOR_SYMBOL, RPAREN);
 }
 
-void Funcproto::rename(const string &oldname, const string &newname) {
-   return_type->rename(oldname, newname);
-   if (oldname == name) {
-      name = newname;
-   }
+void Funcproto::index_names(NameIndex &names) {
+   return_type->index_names(names);
+   names[name].push_back(&name);
    for (vector<VarDecl*>::iterator i = parameters.begin(); i != parameters.end(); i++) {
-      (*i)->rename(oldname, newname);
+      (*i)->index_names(names);
    }
 }
 
@@ -716,10 +801,9 @@ void CallExpr::print() {
    args->do_print();
 }
 
-void CallExpr::rename(const string &oldname, const string &newname) {
-//   dmsg("CallExpr::rename from %s to %s\n", oldname.c_str(), newname.c_str());
-   func->rename(oldname, newname);
-   args->rename(oldname, newname);
+void CallExpr::index_names(NameIndex &names) {
+   func->index_names(names);
+   args->index_names(names);
 }
 
 void Else::print() {
@@ -728,8 +812,8 @@ void Else::print() {
    brace_print(block, false);
 }
 
-void Else::rename(const string &oldname, const string &newname) {
-   block.rename(oldname, newname);
+void Else::index_names(NameIndex &names) {
+   block.index_names(names);
 }
 
 void If::print() {
@@ -745,17 +829,16 @@ void If::print() {
    }
 }
 
-void If::rename(const string &oldname, const string &newname) {
-   ConditionalStatement::rename(oldname, newname);
+void If::index_names(NameIndex &names) {
+   ConditionalStatement::index_names(names);
    if (_else) {
-      _else->rename(oldname, newname);
+      _else->index_names(names);
    }
 }
 
-void ConditionalStatement::rename(const string &oldname, const string &newname) {
-//   dmsg("ConditionalStatement::rename from %s to %s\n", oldname.c_str(), newname.c_str());
-   cond->rename(oldname, newname);
-   block.rename(oldname, newname);
+void ConditionalStatement::index_names(NameIndex &names) {
+   cond->index_names(names);
+   block.index_names(names);
 }
 
 void While::print() {
@@ -791,9 +874,9 @@ void Case::print() {
    }
    append_colored(COLOR_SYMBOL, COLON);
    flush();
-   indent += 3;
+   ctx->indent += 3;
    Block::print();
-   indent -= 3;
+   ctx->indent -= 3;
 }
 
 void Switch::print() {
@@ -805,18 +888,18 @@ void Switch::print() {
    append(' ');
    append_colored(COLOR_SYMBOL, LBRACE);
    flush();
-   indent += 3;
+   ctx->indent += 3;
    for (vector<Case*>::iterator i = cases.begin(); i != cases.end(); i++) {
       (*i)->do_print();
    }
-   indent -= 3;
+   ctx->indent -= 3;
    append_colored(COLOR_SYMBOL, "}");
 }
 
-void Switch::rename(const string &oldname, const string &newname) {
-   cond->rename(oldname, newname);
+void Switch::index_names(NameIndex &names) {
+   cond->index_names(names);
    for (vector<Case*>::iterator i = cases.begin(); i != cases.end(); i++) {
-      (*i)->rename(oldname, newname);
+      (*i)->index_names(names);
    }
 }
 
@@ -828,9 +911,9 @@ void Return::print() {
    }
 }
 
-void Return::rename(const string &oldname, const string &newname) {
+void Return::index_names(NameIndex &names) {
    if (expr) {
-      expr->rename(oldname, newname);
+      expr->index_names(names);
    }
 }
 
@@ -847,10 +930,9 @@ void AssignExpr::print() {
    rval->do_print();
 }
 
-void AssignExpr::rename(const string &oldname, const string &newname) {
-//   dmsg("AssignExpr::rename from %s to %s\n", oldname.c_str(), newname.c_str());
-   lval->rename(oldname, newname);
-   rval->rename(oldname, newname);
+void AssignExpr::index_names(NameIndex &names) {
+   lval->index_names(names);
+   rval->index_names(names);
 }
 
 void Ternary::print() {
@@ -865,10 +947,10 @@ void Ternary::print() {
    _false->do_print();
 }
 
-void Ternary::rename(const string &oldname, const string &newname) {
-   expr->rename(oldname, newname);
-   _true->rename(oldname, newname);
-   _false->rename(oldname, newname);
+void Ternary::index_names(NameIndex &names) {
+   expr->index_names(names);
+   _true->index_names(names);
+   _false->index_names(names);
 }
 
 void Function::print() {
@@ -878,22 +960,271 @@ void Function::print() {
 }
 
 void Function::print(vector<string> *cfunc) {
-   line_index = 0;
-   AstItem::cfunc = cfunc;
-   line.clear();
-   indent = 0;
+   RenderContext rc(render_bytes, render_lines);
+   print(rc);
+   if (cfunc) {
+      rc.get_lines(*cfunc);
+   }
+}
+
+void Function::print(RenderContext &rc) {
+   RenderContext *prev = ctx;
+   ctx = &rc;
+   rc.func = this;
+   line_names.clear();
+   name_lines.clear();
+   pending_names.clear();
+   line_edits.clear();
+   globals.clear();
+   line_items.clear();
+   line_segments.clear();
 
    do_print();
 
-   line_index = 0;
-   AstItem::cfunc = NULL;
-   line.clear();
-   indent = 0;
+   line_segments.resize(line_items.size());
+   for (size_t i = 0; i < line_items.size(); i++) {
+      //items were recorded children first, put parents ahead of children
+      //that cover exactly the same columns
+      std::reverse(line_items[i].begin(), line_items[i].end());
+      index_line(i);
+   }
+
+   line_addrs.clear();
+   for (vector<StatementAddr>::iterator i = addr_map.begin(); i != addr_map.end(); i++) {
+      line_addrs.push_back(LineAddr(i->stmt->line_begin, i->addr));
+   }
+   std::sort(line_addrs.begin(), line_addrs.end());
+
+   rc.func = NULL;
+   ctx = prev;
+   render_bytes = rc.text.size();
+   render_lines = rc.num_lines();
+}
+
+void Function::index_names(NameIndex &names) {
+   prototype.index_names(names);
+   block.index_names(names);
+}
+
+void Function::record_name(const string &v, size_t offset, size_t col) {
+   pending_names.push_back(NamePos(&v, offset, col, v.length()));
+}
+
+//the current line is being emitted as line number 'line', prefixed by 'indent' spaces
+void Function::end_line(size_t line, size_t indent) {
+   if (line >= line_names.size()) {
+      line_names.resize(line + 1);
+   }
+   vector<NamePos> &pos = line_names[line];
+   pos.clear();
+   for (vector<NamePos>::iterator i = pending_names.begin(); i != pending_names.end(); i++) {
+      i->offset += indent;
+      pos.push_back(*i);
+      name_lines.insert(std::make_pair(i->text, line));
+   }
+   pending_names.clear();
+}
+
+void Function::record_item(AstItem *item) {
+   size_t line = item->line_begin;
+   if (line >= line_items.size()) {
+      line_items.resize(line + 1);
+   }
+   line_items[line].push_back(ItemSpan(item, item->col_start, item->col_end));
+}
+
+void Function::record_global(const string &name, int line) {
+   globals.push_back(std::make_pair(name, line));
+}
+
+static bool span_order(const ItemSpan &a, const ItemSpan &b) {
+   if (a.col_start != b.col_start) {
+      return a.col_start < b.col_start;
+   }
+   return a.col_end > b.col_end;
+}
+
+static void add_segment(vector<ItemSegment> &segs, int start, int end, int span) {
+   if (start < end) {
+      segs.push_back(ItemSegment(start, end, span));
+   }
+}
+
+//sort the spans of a line outermost first, link each to its parent, and split
+//the line into runs of columns that share the same innermost item
+void Function::index_line(size_t line) {
+   vector<ItemSpan> &spans = line_items[line];
+   vector<ItemSegment> &segs = line_segments[line];
+   vector<int> open;
+   int cur = 0;
+
+   std::stable_sort(spans.begin(), spans.end(), span_order);
+   segs.clear();
+   for (int i = 0; i <= (int)spans.size(); i++) {
+      int start = i < (int)spans.size() ? spans[i].col_start : INT32_MAX;
+      while (!open.empty() && spans[open.back()].col_end <= start) {
+         ItemSpan &top = spans[open.back()];
+         add_segment(segs, cur, top.col_end, open.back());
+         cur = std::max(cur, top.col_end);
+         open.pop_back();
+      }
+      if (i == (int)spans.size()) {
+         break;
+      }
+      spans[i].parent = open.empty() ? -1 : open.back();
+      if (!open.empty()) {
+         add_segment(segs, cur, start, open.back());
+      }
+      cur = std::max(cur, start);
+      open.push_back(i);
+   }
+}
+
+static bool segment_after(int col, const ItemSegment &seg) {
+   return col < seg.col_start;
+}
+
+const ItemSpan *Function::span_at(int col, int line) const {
+   if (line < 0 || (size_t)line >= line_segments.size()) {
+      return NULL;
+   }
+   const vector<ItemSegment> &segs = line_segments[line];
+   vector<ItemSegment>::const_iterator i = std::upper_bound(segs.begin(), segs.end(), col, segment_after);
+   if (i == segs.begin()) {
+      return NULL;
+   }
+   i--;
+   if (col >= i->col_end) {
+      return NULL;
+   }
+   return &line_items[line][i->span];
+}
+
+const ItemSpan *Function::enclosing(int line, const ItemSpan *s) const {
+   if (s == NULL || s->parent < 0) {
+      return NULL;
+   }
+   return &line_items[line][s->parent];
 }
 
-void Function::rename(const string &oldname, const string &newname) {
-   prototype.rename(oldname, newname);
-   block.rename(oldname, newname);
+bool Function::find_line(uint64_t ea, int *line, int *col) const {
+   vector<StatementAddr>::const_iterator i = std::upper_bound(addr_map.begin(), addr_map.end(),
+                                                              StatementAddr(ea, NULL));
+   if (i == addr_map.begin()) {
+      return false;
+   }
+   i--;
+   //several statements may share an instruction, show the first of them
+   uint64_t found = i->addr;
+   while (i != addr_map.begin() && (i - 1)->addr == found) {
+      i--;
+   }
+   *line = i->stmt->line_begin;
+   *col = i->stmt->col_start;
+   return true;
+}
+
+bool Function::find_addr(int line, uint64_t *ea) const {
+   vector<LineAddr>::const_iterator i = std::lower_bound(line_addrs.begin(), line_addrs.end(),
+                                                         LineAddr(line, 0));
+   if (i == line_addrs.end() || i->line != line) {
+      return false;
+   }
+   *ea = i->addr;
+   return true;
+}
+
+void Function::rename(const string &oldname, const string &newname, vector<size_t> *changed) {
+   NameIndex::iterator ni = names.find(oldname);
+   if (ni == names.end() || oldname == newname) {
+      return;
+   }
+   vector<string*> refs;
+   refs.swap(ni->second);
+   names.erase(ni);
+
+   set<const string*> renamed;
+   set<size_t> lines;
+   for (vector<string*>::iterator i = refs.begin(); i != refs.end(); i++) {
+      **i = newname;
+      renamed.insert(*i);
+      std::pair<multimap<const string*, size_t>::iterator, multimap<const string*, size_t>::iterator> r;
+      r = name_lines.equal_range(*i);
+      for (multimap<const string*, size_t>::iterator li = r.first; li != r.second; li++) {
+         lines.insert(li->second);
+      }
+   }
+   vector<string*> &dest = names[newname];
+   dest.insert(dest.end(), refs.begin(), refs.end());
+
+   for (set<size_t>::iterator li = lines.begin(); li != lines.end(); li++) {
+      if (*li >= line_names.size()) {
+         continue;
+      }
+      vector<NamePos> &pos = line_names[*li];
+      vector<NamePos> edits;    //renamed occurrences at their old positions
+      int64_t shift = 0;
+      for (vector<NamePos>::iterator i = pos.begin(); i != pos.end(); i++) {
+         if (renamed.find(i->text) != renamed.end()) {
+            edits.push_back(*i);
+            i->offset += shift;
+            i->col += shift;
+            shift += (int64_t)newname.length() - (int64_t)i->length;
+            i->length = newname.length();
+         }
+         else {
+            i->offset += shift;
+            i->col += shift;
+         }
+      }
+      vector<LineEdit> &pending = line_edits[*li];
+      pending.push_back(LineEdit(newname));
+      pending.back().at = edits;
+      if (*li < line_items.size() && shift != 0) {
+         //move the columns of everything printed after or around the renamed names
+         vector<ItemSpan> &spans = line_items[*li];
+         for (vector<ItemSpan>::iterator si = spans.begin(); si != spans.end(); si++) {
+            int64_t ds = 0;
+            int64_t de = 0;
+            for (vector<NamePos>::iterator ei = edits.begin(); ei != edits.end(); ei++) {
+               int64_t delta = (int64_t)newname.length() - (int64_t)ei->length;
+               if ((int64_t)(ei->col + ei->length) <= si->col_start) {
+                  ds += delta;
+               }
+               if ((int64_t)ei->col < si->col_end) {
+                  de += delta;
+               }
+            }
+            si->col_start += ds;
+            si->col_end += de;
+            si->item->col_start = si->col_start;
+            si->item->col_end = si->col_end;
+         }
+         index_line(*li);
+      }
+      if (changed) {
+         changed->push_back(*li);
+      }
+   }
+}
+
+//apply the pending renames for line to text, its contents as of the last print
+//or patch. Renames are applied in the order they were made, and the edits of each
+//last to first so their recorded offsets stay valid
+void Function::patch_line(size_t line, string &text) {
+   map<size_t, vector<LineEdit> >::iterator ei = line_edits.find(line);
+   if (ei == line_edits.end()) {
+      return;
+   }
+   vector<LineEdit> &pending = ei->second;
+   for (vector<LineEdit>::iterator pi = pending.begin(); pi != pending.end(); pi++) {
+      for (vector<NamePos>::reverse_iterator i = pi->at.rbegin(); i != pi->at.rend(); i++) {
+         if (i->offset + i->length <= text.length()) {
+            text.replace(i->offset, i->length, pi->name);
+         }
+      }
+   }
+   line_edits.erase(ei);
 }
 
 List::const_iterator find_match(List::const_iterator &it, const string &sym, const string &open) {
@@ -1816,6 +2147,37 @@ static Else *else_handler(List::const_iterator &it) {
    return result;
 }
 
+//gather the op references of el and its children, other than those in nested blocks
+static void collect_oprefs(const Element *el, vector<uint32_t> &refs) {
+   if (tag_map[el->getName()] == ast_tag_block) {
+      return;
+   }
+   const string &ref = getAttributeValue(el, "opref");
+   if (!ref.empty()) {
+      refs.push_back((uint32_t)strtoul(ref.c_str(), NULL, 16));
+   }
+   const List &children = el->getChildren();
+   for (List::const_iterator it = children.begin(); it != children.end(); it++) {
+      collect_oprefs(*it, refs);
+   }
+}
+
+//s was built from the elements first through last
+static void attach_oprefs(Statement *s, List::const_iterator first, List::const_iterator last,
+                          List::const_iterator end) {
+   for (List::const_iterator it = first; it < end && it <= last; it++) {
+      collect_oprefs(*it, s->oprefs);
+   }
+   if (s->oprefs.empty()) {
+      return;
+   }
+   std::sort(s->oprefs.begin(), s->oprefs.end());
+   s->oprefs.erase(std::unique(s->oprefs.begin(), s->oprefs.end()), s->oprefs.end());
+   if (op_statements) {
+      op_statements->push_back(s);
+   }
+}
+
 static void block_handler(const Element *el, Block *block) {
    static int bcount = 0;
    dmsg("block_handler in %d\n", bcount++);
@@ -1824,6 +2186,8 @@ static void block_handler(const Element *el, Block *block) {
    List::const_iterator end = children.end();
    while (it < end) {
       const Element *child = get_child(it);
+      List::const_iterator first = it;
+      size_t count = block->block.size();
       switch (tag_map[child->getName()]) {
          case ast_tag_label: {
             LabelStatement *label = new LabelStatement(child->getContent());
@@ -1920,6 +2284,9 @@ static void block_handler(const Element *el, Block *block) {
          default:
             break;
       }
+      if (block->block.size() > count && block->back()->oprefs.empty()) {
+         attach_oprefs(block->back(), first, it, end);
+      }
       //it can be advance in some of the functions called above
       if (it == end) {
          break;
@@ -2080,7 +2447,24 @@ bool is_reserved(const string &word) {
    return reserved.find(word) != reserved.end();
 }
 
-Function *func_from_xml(Element *func, uint64_t addr) {
+//points new nodes at a Function's arena while its tree is built from xml. Every exit,
+//including a handler throwing, leaves this thread allocating from the heap again, and
+//a tree that was not completed is freed
+struct BuildScope {
+   Function *func;
+
+   BuildScope(Function *f, vector<Statement*> *statements) : func(f) {
+      AstItem::arena = &f->pool;
+      op_statements = statements;
+   };
+   ~BuildScope() {
+      AstItem::arena = NULL;
+      op_statements = NULL;
+      delete func;
+   };
+};
+
+Function *func_from_xml(Element *func, uint64_t addr, const map<uint32_t, uint64_t> *op_addrs) {
    init_maps();
    int num_decls = 0;
    int num_blocks = 0;
@@ -2088,41 +2472,59 @@ Function *func_from_xml(Element *func, uint64_t addr) {
       return NULL;
    }
    Function *result = new Function(addr);
-   bool have_proto = false;
-   const List &children = func->getChildren();
-   for (List::const_iterator it = children.begin(); it < children.end(); it++) {
-      const Element *child = get_child(it);
-      if (!have_proto && child->getName() != "funcproto") {
-         continue;
-      }
-      have_proto = true;
-      switch (tag_map[child->getName()]) {
-         case ast_tag_funcproto:
-            funcproto_handler(child, result);
-            break;
-         case ast_tag_syntax:
-            break;
-         case ast_tag_vardecl: {
-            Statement *s = vardecl_handler(child);
-            if (s) {
-               result->block.push_back(s);
-               num_decls++;
-            }
-            else {
-               //error
+   vector<Statement*> statements;
+   {
+      BuildScope scope(result, &statements);
+      bool have_proto = false;
+      const List &children = func->getChildren();
+      for (List::const_iterator it = children.begin(); it < children.end(); it++) {
+         const Element *child = get_child(it);
+         if (!have_proto && child->getName() != "funcproto") {
+            continue;
+         }
+         have_proto = true;
+         switch (tag_map[child->getName()]) {
+            case ast_tag_funcproto:
+               funcproto_handler(child, result);
+               break;
+            case ast_tag_syntax:
+               break;
+            case ast_tag_vardecl: {
+               Statement *s = vardecl_handler(child);
+               if (s) {
+                  result->block.push_back(s);
+                  num_decls++;
+               }
+               else {
+                  //error
+               }
+               break;
             }
-            break;
+            case ast_tag_block:
+               if (num_decls && !num_blocks) {
+                  result->block.push_back(new EmptyStatement());
+               }
+               block_handler(child, &result->block);
+               num_blocks++;
+               break;
+            default:
+               break;
          }
-         case ast_tag_block:
-            if (num_decls && !num_blocks) {
-               result->block.push_back(new EmptyStatement());
+      }
+      scope.func = NULL;   //complete, keep it
+   }
+   result->index_names(result->names);
+   if (op_addrs) {
+      for (vector<Statement*>::iterator si = statements.begin(); si != statements.end(); si++) {
+         vector<uint32_t> &refs = (*si)->oprefs;
+         for (vector<uint32_t>::iterator ri = refs.begin(); ri != refs.end(); ri++) {
+            map<uint32_t, uint64_t>::const_iterator ai = op_addrs->find(*ri);
+            if (ai != op_addrs->end()) {
+               result->addr_map.push_back(StatementAddr(ai->second, *si));
             }
-            block_handler(child, &result->block);
-            num_blocks++;
-            break;
-         default:
-            break;
+         }
       }
+      std::sort(result->addr_map.begin(), result->addr_map.end());
    }
    return result;
 }
@@ -2156,30 +2558,13 @@ VarDecl *find_decl(Function *ast, const string &sword) {
 }
 
 VarDecl *find_decl(Function *ast, int col, int line) {
-   vector<Statement*> &bk = ast->block.block;
-   vector<VarDecl*> &parms = ast->prototype.parameters;
-
-   //Scan function parameters
-   for (vector<VarDecl*>::iterator i = parms.begin(); i != parms.end(); i++) {
-      VarDecl *decl = *i;
-      if (decl->col_start <= col && decl->col_end > col && decl->line_begin == line && decl->line_end == line) {
-         return decl;
-      }
-   }
-
-   //Scan locals
-   for (vector<Statement*>::iterator i = bk.begin(); i != bk.end(); i++) {
-      VarDecl *decl = dynamic_cast<VarDecl*>(*i);
+   //walk out from the innermost item under the cursor
+   for (const ItemSpan *s = ast->span_at(col, line); s; s = ast->enclosing(line, s)) {
+      VarDecl *decl = dynamic_cast<VarDecl*>(s->item);
       if (decl) {
-         if (decl->col_start <= col && decl->col_end > col && decl->line_begin == line && decl->line_end == line) {
-            return decl;
-         }
-      }
-      else {
-         break;
+         return decl;
       }
    }
-
    return NULL;
 }
 
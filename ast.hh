@@ -22,9 +22,14 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
 
 using std::string;
 using std::vector;
+using std::map;
+using std::multimap;
+using std::set;
 
 //A very crude AST for representing Ghidra generated
 //decompilations
@@ -35,23 +40,125 @@ using std::vector;
 //of an assignment is an lval, which we just assume ghidra has
 //enforced
 
+//every name held by the tree, mapped to the AstItem fields that hold it
+typedef map<string, vector<string*> > NameIndex;
+
+//where a name was placed when a Function was last printed
+struct NamePos {
+   const string *text;   //the AstItem field that was printed
+   size_t offset;        //byte offset into the line, including indent and color codes
+   size_t col;           //column in the same units as AstItem::col_start
+   size_t length;        //number of bytes printed
+
+   NamePos(const string *t, size_t o, size_t c, size_t l) : text(t), offset(o), col(c), length(l) {};
+};
+
+//one rename's edits to a printed line. Positions are against the text left by
+//the renames made before it
+struct LineEdit {
+   string name;              //text the occurrences are replaced with
+   vector<NamePos> at;       //occurrences of the old name
+
+   LineEdit(const string &n) : name(n) {};
+};
+
+struct AstItem;
+struct Function;
+
+//Bump allocator and string pool owning every node of one Function's tree.
+//Nodes are never freed individually, the memory is released when the arena
+//is destroyed
+struct AstArena {
+   vector<char*> chunks;
+   size_t used;            //bytes handed out from chunks.back()
+   size_t avail;           //size of chunks.back()
+   set<string> strings;    //interned operators and literal values
+
+   AstArena() : used(0), avail(0) {};
+   ~AstArena();
+
+   void *alloc(size_t sz);
+   const string &intern(const string &s);
+};
+
+//Output of a single render. All lines live in one buffer, line i being
+//text[line_offsets[i], line_offsets[i + 1]). The line currently being
+//built runs from line_offsets.back() to the end of text
+struct RenderContext {
+   string text;
+   vector<size_t> line_offsets;
+   size_t indent;
+   size_t line_index;   //column in the current line, discounting color codes
+   Function *func;      //function whose print positions are recorded, NULL for none
+
+   RenderContext(size_t bytes = 0, size_t lines = 0);
+
+   size_t num_lines() const {return line_offsets.size() - 1;};
+   size_t line_start() const {return line_offsets.back();};
+   string get_line(size_t i) const;
+   void get_lines(vector<string> &lines) const;
+};
+
+//the columns covered by an AstItem that was printed on a single line
+struct ItemSpan {
+   int col_start;
+   int col_end;
+   AstItem *item;
+   int parent;     //index of the enclosing span on the same line, -1 if none
+
+   ItemSpan(AstItem *i, int start, int end) : col_start(start), col_end(end), item(i), parent(-1) {};
+};
+
+struct Statement;
+
+//an instruction address and the statement that renders one of its ops
+struct StatementAddr {
+   uint64_t addr;
+   Statement *stmt;
+
+   StatementAddr(uint64_t a, Statement *s) : addr(a), stmt(s) {};
+   bool operator<(const StatementAddr &other) const {return addr < other.addr;};
+};
+
+//an instruction address and the line it was printed on
+struct LineAddr {
+   int line;
+   uint64_t addr;
+
+   LineAddr(int l, uint64_t a) : line(l), addr(a) {};
+   bool operator<(const LineAddr &other) const {
+      return line != other.line ? line < other.line : addr < other.addr;
+   };
+};
+
+//a run of columns whose innermost item is spans[span]
+struct ItemSegment {
+   int col_start;
+   int col_end;
+   int span;
+
+   ItemSegment(int start, int end, int s) : col_start(start), col_end(end), span(s) {};
+};
+
 struct AstItem {
 
-   static vector<string> *cfunc;
-   static string line;
-   static size_t indent;
+   static thread_local RenderContext *ctx;   //render in progress on this thread
+   static thread_local AstArena *arena;    //arena new nodes are allocated from on this thread, NULL for the heap
+
+   static void *operator new(size_t sz);
+   static void operator delete(void *ptr);
+   static const string &intern(const string &s);
    static void flush(bool no_indent = false);
    static void append(char ch, bool count = true);
    static void append(const char *v);
    static void append(const string &v);
    static void append_colored(char tag, const char *v);
    static void append_colored(char tag, const string &v);
+   static void append_name(const string &v);
+   static void append_name(char tag, const string &v);
    static void color_on(char tag);
    static void color_off(char tag);
 
-   //index into line discounting color codes
-   static size_t line_index;
-
    int line_begin;
    int line_end;
    int col_start;
@@ -69,10 +176,12 @@ struct AstItem {
 
    virtual void print() = 0;
 
-   virtual void rename(const string &oldname, const string &newname) {}
+   virtual void index_names(NameIndex &names) {}
 };
 
 struct Statement : public AstItem {
+   vector<uint32_t> oprefs;   //Ghidra op sequence numbers (PcodeOp::getTime) rendered here
+
    virtual ~Statement() {};
    virtual void print();
 };
@@ -88,7 +197,7 @@ struct Type : public AstItem {
    virtual void print();
    virtual void print(const string &var);
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct Expression : public AstItem {
@@ -104,7 +213,7 @@ struct NameExpr : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct FuncNameExpr : public NameExpr {
@@ -113,32 +222,32 @@ struct FuncNameExpr : public NameExpr {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct BinaryExpr : public Expression {
-   const string op;
+   const string &op;
    Expression *lhs;
    Expression *rhs;
 
-   BinaryExpr(const string &binop, Expression *left, Expression *right) : op(binop), lhs(left), rhs(right) {};
+   BinaryExpr(const string &binop, Expression *left, Expression *right) : op(intern(binop)), lhs(left), rhs(right) {};
    ~BinaryExpr() {delete lhs; delete rhs;}
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct UnaryExpr : public Expression {
-   const string op;
+   const string &op;
    Expression *expr;
 
-   UnaryExpr(const string &unop, Expression *ex) : op(unop), expr(ex) {};
+   UnaryExpr(const string &unop, Expression *ex) : op(intern(unop)), expr(ex) {};
    ~UnaryExpr() {delete expr;};
    
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct ParenExpr : public Expression {
@@ -149,7 +258,7 @@ struct ParenExpr : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct ArrayExpr : public Expression {
@@ -161,7 +270,7 @@ struct ArrayExpr : public Expression {
    
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct BreakStatement : public Statement {
@@ -175,7 +284,7 @@ struct LabelExpr : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct LabelStatement : public Statement {
@@ -188,7 +297,7 @@ struct LabelStatement : public Statement {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct GotoStatement : public Statement {
@@ -198,7 +307,7 @@ struct GotoStatement : public Statement {
    
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct Block : public AstItem {
@@ -210,7 +319,7 @@ struct Block : public AstItem {
    Statement * &back() {return block.back();};
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct VarDecl : public Statement {
@@ -226,7 +335,7 @@ struct VarDecl : public Statement {
 
    const string &getName();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct Funcproto : public AstItem {
@@ -240,7 +349,7 @@ struct Funcproto : public AstItem {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct CastExpr : public Expression {
@@ -251,7 +360,7 @@ struct CastExpr : public Expression {
    
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct CommaExpr : public Expression {
@@ -263,7 +372,7 @@ struct CommaExpr : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct TypeCast : public Expression {
@@ -275,7 +384,7 @@ struct TypeCast : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct CallExpr : public Expression {
@@ -288,12 +397,12 @@ struct CallExpr : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct LiteralExpr : public Expression {
-   const string val;
-   LiteralExpr(const string &literal) : val(literal) {};
+   const string &val;
+   LiteralExpr(const string &literal) : val(intern(literal)) {};
 
    virtual void print();
 };
@@ -341,7 +450,7 @@ struct ConditionalStatement : public Statement {
    void push_back(Statement *stmt) {block.push_back(stmt);};
    Statement * &back() {return block.back();};
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct Else : public AstItem {
@@ -351,7 +460,7 @@ struct Else : public AstItem {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct If : public ConditionalStatement {
@@ -362,7 +471,7 @@ struct If : public ConditionalStatement {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct While : public ConditionalStatement {
@@ -395,7 +504,7 @@ struct Switch : public Statement {
    
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct Return : public Statement {
@@ -406,7 +515,7 @@ struct Return : public Statement {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct AssignExpr : public Expression {
@@ -418,7 +527,7 @@ struct AssignExpr : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct ExprStatement : public Statement {
@@ -429,7 +538,7 @@ struct ExprStatement : public Statement {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 struct Ternary : public Expression {
@@ -442,26 +551,66 @@ struct Ternary : public Expression {
 
    virtual void print();
 
-   virtual void rename(const string &oldname, const string &newname);
+   virtual void index_names(NameIndex &names);
 };
 
 //we are only interested in function trees
 //NOT entire program trees
 struct Function : public Statement {
+   AstArena pool;   //declared first so it outlives the nodes destroyed below
    uint64_t addr;
    Funcproto prototype;
    Block block;
 
-   Function(uint64_t ea) : addr(ea) {};
+   NameIndex names;                    //built once the tree is complete
+   vector<vector<NamePos> > line_names; //names printed on each line of the last print
+   multimap<const string*, size_t> name_lines;  //line(s) on which each name field was printed
+   vector<NamePos> pending_names;      //names printed on the line currently being built
+   map<size_t, vector<LineEdit> > line_edits;   //renames not yet applied to the printed text, in order
+   vector<vector<ItemSpan> > line_items;       //single line items of the last print, by line
+   vector<vector<ItemSegment> > line_segments; //disjoint, sorted column runs, by line
+   vector<StatementAddr> addr_map;     //sorted by address, built with the tree
+   vector<LineAddr> line_addrs;        //sorted by line, rebuilt by each print
+   vector<std::pair<string, int> > globals;   //global names referenced, and their lines
+
+   size_t render_bytes;   //size of the last render, used to presize the next one
+   size_t render_lines;
+
+   Function(uint64_t ea) : addr(ea), render_bytes(0), render_lines(0) {};
 
    virtual void print();
    virtual void print(vector<string> *cfunc);
+   void print(RenderContext &rc);
+
+   virtual void index_names(NameIndex &names);
+
+   void record_name(const string &v, size_t offset, size_t col);
+   void end_line(size_t line, size_t indent);
+
+   void record_item(AstItem *item);
+   void record_global(const string &name, int line);
+   void index_line(size_t line);
+
+   //innermost item printed at col on line, NULL if none
+   const ItemSpan *span_at(int col, int line) const;
+   //the span enclosing s on the same line, NULL if none
+   const ItemSpan *enclosing(int line, const ItemSpan *s) const;
+
+   //position of the statement rendering the instruction at ea, or the
+   //closest instruction before it
+   bool find_line(uint64_t ea, int *line, int *col) const;
+   //lowest instruction address rendered on line
+   bool find_addr(int line, uint64_t *ea) const;
 
-   virtual void rename(const string &oldname, const string &newname);
+   //rename every occurrence of oldname. Lines of the last print that show it
+   //are added to changed and must each be brought up to date with patch_line
+   void rename(const string &oldname, const string &newname, vector<size_t> *changed = NULL);
+   void patch_line(size_t line, string &text);
 };
 
 class Element;
-Function *func_from_xml(Element *el, uint64_t addr);
+//op_addrs maps the opref attributes in the xml to instruction addresses
+Function *func_from_xml(Element *el, uint64_t addr, const map<uint32_t, uint64_t> *op_addrs = NULL);
 
 bool is_reserved(const string &word);
 
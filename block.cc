@@ -1837,12 +1837,99 @@ void BlockGraph::clearVisitCount(void)
     list[i]->visitcount = 0;
 }
 
+uint4 BlockGraph::dominatorThreshold = 2000;
+
+/// \brief Calculate immediate dominators using the Semi-NCA algorithm
+///
+/// Semi-dominators are computed as in Lengauer-Tarjan, using a depth-first spanning tree
+/// of the graph and path compression. Immediate dominators are then recovered by walking
+/// up the spanning tree to the nearest ancestor that is at or above the semi-dominator.
+/// Georgiadis, Tarjan, and Werneck. Finding Dominators in Practice. JGAA 2006; 10(1): 69-94
+/// The root must have no incoming edges, and every block must be reachable from it.
+/// \param root is the (possibly virtual) root of the graph
+void BlockGraph::calcDominatorSemiNCA(FlowBlock *root)
+
+{
+  vector<int4> dfnum(list.size(),-1);	// Pre-order number of each block, indexed by block index
+  vector<FlowBlock *> vertex;		// Blocks in pre-order
+  vector<int4> parent;			// Pre-order number of the spanning tree parent
+  vector<pair<FlowBlock *,int4> > stack;
+
+  vertex.push_back(root);
+  parent.push_back(-1);
+  stack.push_back(pair<FlowBlock *,int4>(root,0));
+  while(!stack.empty()) {
+    FlowBlock *bl = stack.back().first;
+    int4 slot = stack.back().second;
+    if (slot >= bl->sizeOut()) {
+      stack.pop_back();
+      continue;
+    }
+    stack.back().second += 1;
+    FlowBlock *child = bl->getOut(slot);
+    if (child == root || dfnum[child->index] >= 0) continue;
+    dfnum[child->index] = vertex.size();
+    parent.push_back((bl == root) ? 0 : dfnum[bl->index]);
+    vertex.push_back(child);
+    stack.push_back(pair<FlowBlock *,int4>(child,0));
+  }
+
+  int4 num = vertex.size();
+  vector<int4> semi(num);
+  vector<int4> label(num);
+  vector<int4> ancestor(num,-1);
+  vector<int4> idom(num);
+  vector<int4> path;
+  for(int4 i=0;i<num;++i) {
+    semi[i] = i;
+    label[i] = i;
+  }
+  for(int4 i=num-1;i>0;--i) {
+    FlowBlock *bl = vertex[i];
+    for(int4 j=0;j<bl->sizeIn();++j) {
+      FlowBlock *pred = bl->getIn(j);
+      int4 v = (pred == root) ? 0 : dfnum[pred->index];
+      if (v < 0) continue;	// Predecessor not reachable from root
+      if (ancestor[v] >= 0) {	// Evaluate v, compressing the path to its forest root
+	path.clear();
+	int4 u = v;
+	while(ancestor[ancestor[u]] >= 0) {
+	  path.push_back(u);
+	  u = ancestor[u];
+	}
+	for(int4 k=path.size()-1;k>=0;--k) {
+	  u = path[k];
+	  int4 a = ancestor[u];
+	  if (semi[label[a]] < semi[label[u]])
+	    label[u] = label[a];
+	  ancestor[u] = ancestor[a];
+	}
+	v = label[v];
+      }
+      if (semi[v] < semi[i])
+	semi[i] = semi[v];
+    }
+    ancestor[i] = parent[i];	// Link into the forest
+  }
+  idom[0] = 0;
+  root->immed_dom = root;
+  for(int4 i=1;i<num;++i) {
+    int4 d = parent[i];
+    while(d > semi[i])		// Nearest common ancestor of parent and semi-dominator
+      d = idom[d];
+    idom[i] = d;
+    vertex[i]->immed_dom = vertex[d];
+  }
+}
+
 /// Calculate the immediate dominator for each FlowBlock node in \b this BlockGraph,
 /// for forward control-flow.
 /// The algorithm must be provided a list of entry points for the graph.
 /// We assume the blocks are in reverse post-order and this is reflected in the index field.
 /// Using an algorithm by Cooper, Harvey, and Kennedy.
 /// Softw. Pract. Exper. 2001; 4: 1-10
+/// For graphs with at least \b dominatorThreshold blocks, the near-linear calcDominatorSemiNCA()
+/// is used instead, as the iterative algorithm can be quadratic on very large graphs.
 /// \param rootlist is the list of entry point FlowBlocks
 void BlockGraph::calcForwardDominator(const vector<FlowBlock *> &rootlist)
 
@@ -1875,39 +1962,43 @@ void BlockGraph::calcForwardDominator(const vector<FlowBlock *> &rootlist)
     postorder.push_back(virtualroot);
     b = virtualroot;
   }
-  b->immed_dom = b;
-  for(i=0;i<b->sizeOut();++i)	// Fill in dom of nodes which start immediately
-    b->getOut(i)->immed_dom = b;	// connects to (to deal with possible artificial edge)
-  changed = true;
-  new_idom = (FlowBlock *)0;
-  while(changed) {
-    changed = false;
-    for(i=postorder.size()-2;i>=0;--i) { // For all nodes, in reverse post-order, except root
-      b = postorder[i];
-      if (b->immed_dom != postorder.back()) {
-	for(j=0;j<b->sizeIn();++j) { // Find first processed node
-	  new_idom = b->getIn(j);
-	  if (new_idom->immed_dom != (FlowBlock *)0)
-	    break;
-	}
-	j += 1;
-	for(;j<b->sizeIn();++j) {
-	  rho = b->getIn(j);
-	  if (rho->immed_dom != (FlowBlock *)0) { // Here is the intersection routine
-	    finger1 = numnodes - rho->index;
-	    finger2 = numnodes - new_idom->index;
-	    while(finger1 != finger2) {
-	      while(finger1 < finger2)
-		finger1 = numnodes - postorder[finger1]->immed_dom->index;
-	      while(finger2 < finger1)
-		finger2 = numnodes - postorder[finger2]->immed_dom->index;
+  if (postorder.size() >= dominatorThreshold)
+    calcDominatorSemiNCA(b);
+  else {
+    b->immed_dom = b;
+    for(i=0;i<b->sizeOut();++i)	// Fill in dom of nodes which start immediately
+      b->getOut(i)->immed_dom = b;	// connects to (to deal with possible artificial edge)
+    changed = true;
+    new_idom = (FlowBlock *)0;
+    while(changed) {
+      changed = false;
+      for(i=postorder.size()-2;i>=0;--i) { // For all nodes, in reverse post-order, except root
+	b = postorder[i];
+	if (b->immed_dom != postorder.back()) {
+	  for(j=0;j<b->sizeIn();++j) { // Find first processed node
+	    new_idom = b->getIn(j);
+	    if (new_idom->immed_dom != (FlowBlock *)0)
+	      break;
+	  }
+	  j += 1;
+	  for(;j<b->sizeIn();++j) {
+	    rho = b->getIn(j);
+	    if (rho->immed_dom != (FlowBlock *)0) { // Here is the intersection routine
+	      finger1 = numnodes - rho->index;
+	      finger2 = numnodes - new_idom->index;
+	      while(finger1 != finger2) {
+		while(finger1 < finger2)
+		  finger1 = numnodes - postorder[finger1]->immed_dom->index;
+		while(finger2 < finger1)
+		  finger2 = numnodes - postorder[finger2]->immed_dom->index;
+	      }
+	      new_idom = postorder[finger1];
 	    }
-	    new_idom = postorder[finger1];
 	  }
-	}
-	if (b->immed_dom != new_idom) {
-	  b->immed_dom = new_idom;
-	  changed = true;
+	  if (b->immed_dom != new_idom) {
+	    b->immed_dom = new_idom;
+	    changed = true;
+	  }
 	}
       }
     }
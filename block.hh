@@ -277,11 +277,13 @@ class BlockGraph : public FlowBlock {
   static FlowBlock *createVirtualRoot(const vector<FlowBlock *> &rootlist);
   void findSpanningTree(vector<FlowBlock *> &preorder,vector<FlowBlock *> &rootlist);
   bool findIrreducible(const vector<FlowBlock *> &preorder,int4 &irreduciblecount);
+  void calcDominatorSemiNCA(FlowBlock *root);	///< Calculate forward dominators for a large graph
   void forceFalseEdge(const FlowBlock *out0);	///< Force the \e false out edge to go to the given FlowBlock
 protected:
   void swapBlocks(int4 i,int4 j);	///< Swap the positions two component FlowBlocks
   static void markCopyBlock(FlowBlock *bl,uint4 fl);	///< Set properties on the first leaf FlowBlock
 public:
+  static uint4 dominatorThreshold;			///< Number of blocks at which to switch dominator algorithms
   void clear(void);					///< Clear all component FlowBlock objects
   virtual ~BlockGraph(void) { clear(); }		///< Destructor
   const vector<FlowBlock *> &getList(void) const { return list; }	///< Get the list of component FlowBlock objects
@@ -0,0 +1,571 @@
+/* ###
+ * IP: GHIDRA
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "callgraph.hh"
+#include "funcdata.hh"
+
+void CallGraphEdge::saveXml(ostream &s) const
+
+{
+  s << " <edge>\n";
+  s << "  ";
+  from->getAddr().saveXml(s);
+  s << "\n  ";
+  to->getAddr().saveXml(s);
+  s << "\n  ";
+  callsiteaddr.saveXml(s);
+  s << "\n </edge>\n";
+}
+
+void CallGraphEdge::restoreXml(const Element *el,CallGraph *graph)
+
+{
+  const List &list(el->getChildren());
+  List::const_iterator iter = list.begin();
+  const AddrSpaceManager *manage = graph->getArch();
+  Address fromaddr = Address::restoreXml(*iter,manage);
+  ++iter;
+  Address toaddr = Address::restoreXml(*iter,manage);
+  ++iter;
+  Address siteaddr = Address::restoreXml(*iter,manage);
+
+  CallGraphNode *fromnode = graph->findNode(fromaddr);
+  if (fromnode == (CallGraphNode *)0)
+    throw LowlevelError("Could not find from node");
+  CallGraphNode *tonode = graph->findNode(toaddr);
+  if (tonode == (CallGraphNode *)0)
+    throw LowlevelError("Could not find to node");
+
+  graph->addEdge(fromnode,tonode,siteaddr);
+}
+
+void CallGraphNode::setFuncdata(Funcdata *f)
+
+{
+  if ((fd != (Funcdata *)0)&&(fd != f))
+    throw LowlevelError("Multiple functions at one address in callgraph");
+
+  if (f->getAddress() != entryaddr)
+    throw LowlevelError("Setting function data at wrong address in callgraph");
+  fd = f;
+}
+
+void CallGraphNode::saveXml(ostream &s) const
+
+{
+  s << " <node";
+  if (name.size() != 0)
+    a_v(s,"name",name);
+  s << ">\n  ";
+  entryaddr.saveXml(s);
+  s << "\n </node>\n";
+}
+
+void CallGraphNode::restoreXml(const Element *el,CallGraph *graph)
+
+{
+  string name;
+  for(int4 i=0;i<el->getNumAttributes();++i)
+    if (el->getAttributeName(i) == "name")
+      name = el->getAttributeValue(i);
+  const List &list(el->getChildren());
+  Address addr = Address::restoreXml(*list.begin(),graph->getArch());
+  graph->addNode(addr,name);
+}
+
+/// Find all functions (that are not already marked) that either have no in edges at all,
+/// or have no in edges that haven't been snipped as part of cycles.  If every remaining
+/// node is in a cycle, the node with the fewest in edges is used as a pseudo root.
+/// \param seeds will hold the new seed nodes
+/// \return \b true if every node in the graph has been covered by a seed
+bool CallGraph::findNoEntry(vector<CallGraphNode *> &seeds)
+
+{
+  map<Address,CallGraphNode>::iterator iter;
+  CallGraphNode *lownode = (CallGraphNode *)0;
+  bool allcovered = true;
+  bool newseeds = false;
+
+  for(iter=graph.begin();iter!=graph.end();++iter) {
+    CallGraphNode &node( (*iter).second );
+    if (node.isMark()) continue;
+    if ((node.inedge.size()==0)||((node.flags&CallGraphNode::onlycyclein)!=0)) {
+      seeds.push_back(&node);
+      node.flags |= CallGraphNode::mark | CallGraphNode::entrynode;
+      newseeds = true;
+    }
+    else {
+      allcovered = false;
+      if (lownode == (CallGraphNode *)0)
+	lownode = &node;
+      else if (node.numInEdge() < lownode->numInEdge())
+	lownode = &node;
+    }
+  }
+  if ((!newseeds)&&(!allcovered)) {
+    seeds.push_back(lownode);
+    lownode->flags |= CallGraphNode::mark | CallGraphNode::entrynode;
+  }
+  return allcovered;
+}
+
+/// Walk the graph depth-first from the given root, snipping any edge that closes a cycle
+/// and marking any edge to an already visited node as outside the spanning tree.
+/// \param node is the root to start from
+void CallGraph::snipCycles(CallGraphNode *node)
+
+{
+  CallGraphNode *next;
+  vector<LeafIterator> stack;
+
+  node->flags |= CallGraphNode::currentcycle;
+  stack.push_back(LeafIterator(node));
+
+  while(!stack.empty()) {
+    CallGraphNode *cur = stack.back().node;
+    int4 st = stack.back().outslot;
+    if (st >= cur->outedge.size()) {
+      cur->flags &= ~((uint4)CallGraphNode::currentcycle);
+      stack.pop_back();
+    }
+    else {
+      stack.back().outslot += 1;
+      if ((cur->outedge[st].flags&CallGraphEdge::cycle)!=0) continue;
+      next = cur->outedge[st].to;
+      if ((next->flags & CallGraphNode::currentcycle)!=0) { // Found a cycle
+	snipEdge(cur,st);
+	continue;
+      }
+      else if ((next->flags & CallGraphNode::mark)!=0) { // Already traced before
+	cur->outedge[st].flags |= CallGraphEdge::dontfollow;
+	continue;
+      }
+      next->parentedge = cur->outedge[st].complement;
+      next->flags |= (CallGraphNode::currentcycle | CallGraphNode::mark);
+      stack.push_back(LeafIterator(next));
+    }
+  }
+}
+
+/// \param node is the calling node
+/// \param i is the index of the out edge to snip
+void CallGraph::snipEdge(CallGraphNode *node,int4 i)
+
+{
+  node->outedge[i].flags |= CallGraphEdge::cycle | CallGraphEdge::dontfollow;
+  int4 toi = node->outedge[i].complement;
+  CallGraphNode *to = node->outedge[i].to;
+  to->inedge[toi].flags |= CallGraphEdge::cycle;
+  bool onlycycle = true;
+  for(uint4 j=0;j<to->inedge.size();++j) {
+    if ((to->inedge[j].flags & CallGraphEdge::cycle)==0) {
+      onlycycle = false;
+      break;
+    }
+  }
+  if (onlycycle)
+    to->flags |= CallGraphNode::onlycyclein;
+}
+
+void CallGraph::clearMarks(void)
+
+{
+  map<Address,CallGraphNode>::iterator iter;
+  for(iter=graph.begin();iter!=graph.end();++iter)
+    (*iter).second.clearMark();
+}
+
+/// Generate the list of seed nodes, from which every node can be reached, and
+/// snip cycles so that the remaining edges form a spanning forest.
+void CallGraph::cycleStructure(void)
+
+{
+  if (!seeds.empty())
+    return;
+  uint4 walked = 0;
+  bool allcovered;
+
+  do {
+    allcovered = findNoEntry(seeds);
+    while(walked < seeds.size()) {
+      CallGraphNode *rootnode = seeds[walked];
+      rootnode->parentedge = walked;
+      snipCycles(rootnode);
+      walked += 1;
+    }
+  } while(!allcovered);
+  clearMarks();
+}
+
+/// \param node is the current node in the spanning tree walk
+/// \param outslot will hold the index of the edge in the parent used to reach \b node
+/// \return the parent node or null if \b node is a seed
+CallGraphNode *CallGraph::popPossible(CallGraphNode *node,int4 &outslot)
+
+{
+  if ((node->flags & CallGraphNode::entrynode)!=0) {
+    outslot = node->parentedge;
+    return (CallGraphNode *)0;
+  }
+  outslot = node->inedge[node->parentedge].complement;
+  return node->inedge[node->parentedge].from;
+}
+
+/// \param node is the current node, or null to iterate over the seeds
+/// \param outslot is the first out edge to consider
+/// \return the first child reachable through a spanning tree edge, or null
+CallGraphNode *CallGraph::pushPossible(CallGraphNode *node,int4 outslot)
+
+{
+  if (node == (CallGraphNode *)0) {
+    if (outslot >= seeds.size())
+      return (CallGraphNode *)0;
+    return seeds[outslot];
+  }
+  while(outslot < node->outedge.size()) {
+    if ((node->outedge[outslot].flags & CallGraphEdge::dontfollow)!=0)
+      outslot += 1;
+    else
+      return node->outedge[outslot].to;
+  }
+  return (CallGraphNode *)0;
+}
+
+/// Out edges are kept sorted by the address of the callee, so open a slot in the
+/// middle of the list and fix up the complement of every edge that moved.
+/// \param node is the calling node
+/// \param slot is the index of the new edge
+/// \return the new (blank) edge
+CallGraphEdge &CallGraph::insertBlankEdge(CallGraphNode *node,int4 slot)
+
+{
+  node->outedge.push_back(CallGraphEdge());
+  for(int4 i=node->outedge.size()-2;i>=slot;--i) {
+    CallGraphEdge &edge( node->outedge[i+1] );
+    edge = node->outedge[i];
+    edge.to->inedge[edge.complement].complement = i+1;
+  }
+  return node->outedge[slot];
+}
+
+/// \param scope is the global Scope to start from
+void CallGraph::iterateScopesRecursive(Scope *scope)
+
+{
+  if (!scope->isGlobal()) return;
+  iterateFunctionsAddrOrder(scope);
+  ScopeMap::const_iterator iter,enditer;
+  iter = scope->childrenBegin();
+  enditer = scope->childrenEnd();
+  for(;iter!=enditer;++iter)
+    iterateScopesRecursive((*iter).second);
+}
+
+/// \param scope is the Scope whose function symbols become nodes
+void CallGraph::iterateFunctionsAddrOrder(Scope *scope)
+
+{
+  MapIterator miter,menditer;
+  miter = scope->begin();
+  menditer = scope->end();
+  while(miter != menditer) {
+    Symbol *sym = (*miter)->getSymbol();
+    FunctionSymbol *fsym = dynamic_cast<FunctionSymbol *>(sym);
+    ++miter;
+    if (fsym != (FunctionSymbol *)0)
+      addNode(fsym->getFunction());
+  }
+}
+
+/// \param f is the function to add
+/// \return the (possibly preexisting) node
+CallGraphNode *CallGraph::addNode(Funcdata *f)
+
+{
+  CallGraphNode &node( graph[f->getAddress()] );
+
+  if ((node.getFuncdata() != (Funcdata *)0)&&(node.getFuncdata() != f))
+    throw LowlevelError("Functions with duplicate entry points: "+f->getName()+" "+node.getFuncdata()->getName());
+
+  node.entryaddr = f->getAddress();
+  node.name = f->getName();
+  node.fd = f;
+  return &node;
+}
+
+/// \param addr is the entry point of the function
+/// \param nm is the name of the function
+/// \return the (possibly preexisting) node
+CallGraphNode *CallGraph::addNode(const Address &addr,const string &nm)
+
+{
+  CallGraphNode &node( graph[addr] );
+
+  node.entryaddr = addr;
+  node.name = nm;
+  return &node;
+}
+
+/// \param addr is the entry point of the function
+/// \return the matching node or null
+CallGraphNode *CallGraph::findNode(const Address &addr)
+
+{
+  map<Address,CallGraphNode>::iterator iter = graph.find(addr);
+  if (iter != graph.end())
+    return &(*iter).second;
+  return (CallGraphNode *)0;
+}
+
+/// Only one edge is kept between any pair of functions.
+/// \param from is the calling function
+/// \param to is the called function
+/// \param addr is the address of the call site
+void CallGraph::addEdge(CallGraphNode *from,CallGraphNode *to,const Address &addr)
+
+{
+  int4 i;
+  for(i=0;i<from->outedge.size();++i) {
+    CallGraphNode *outnode = from->outedge[i].to;
+    if (outnode == to) return;	// Already have an out edge
+    if (to->entryaddr < outnode->entryaddr) break;
+  }
+
+  CallGraphEdge &fromedge( insertBlankEdge(from,i) );
+
+  int4 toi = to->inedge.size();
+  to->inedge.push_back(CallGraphEdge());
+  CallGraphEdge &toedge( to->inedge.back() );
+
+  fromedge.from = from;
+  fromedge.to = to;
+  fromedge.callsiteaddr = addr;
+  fromedge.complement = toi;
+
+  toedge.from = from;
+  toedge.to = to;
+  toedge.callsiteaddr = addr;
+  toedge.complement = i;
+}
+
+/// Remove the edge from both endpoints, renumbering the complements of edges that move.
+/// \param node is the called function
+/// \param i is the index of the in edge to remove
+void CallGraph::deleteInEdge(CallGraphNode *node,int4 i)
+
+{
+  CallGraphNode *from = node->inedge[i].from;
+  int4 fromi = node->inedge[i].complement;
+
+  node->inedge.erase(node->inedge.begin()+i);
+  for(int4 j=i;j<node->inedge.size();++j) {
+    CallGraphEdge &edge( node->inedge[j] );
+    edge.from->outedge[edge.complement].complement = j;
+  }
+
+  from->outedge.erase(from->outedge.begin()+fromi);
+  for(int4 j=fromi;j<from->outedge.size();++j) {
+    CallGraphEdge &edge( from->outedge[j] );
+    edge.to->inedge[edge.complement].complement = j;
+  }
+}
+
+/// Nodes are visited in post-order along the spanning forest, so (outside of snipped
+/// cycles) every callee is visited before its callers.
+/// \return the first leaf or null if the graph is empty
+CallGraphNode *CallGraph::initLeafWalk(void)
+
+{
+  cycleStructure();
+  if (seeds.empty()) return (CallGraphNode *)0;
+  CallGraphNode *node = seeds[0];
+  for(;;) {
+    CallGraphNode *pushnode = pushPossible(node,0);
+    if (pushnode == (CallGraphNode *)0)
+      break;
+    node = pushnode;
+  }
+  return node;
+}
+
+/// \param node is the current node of the walk
+/// \return the next node in post-order or null if the walk is complete
+CallGraphNode *CallGraph::nextLeaf(CallGraphNode *node)
+
+{
+  int4 outslot;
+  node = popPossible(node,outslot);
+  outslot += 1;
+  for(;;) {
+    CallGraphNode *pushnode = pushPossible(node,outslot);
+    if (pushnode == (CallGraphNode *)0)
+      break;
+    node = pushnode;
+    outslot = 0;
+  }
+  return node;
+}
+
+/// Tarjan's algorithm, run iteratively so deep call chains cannot exhaust the stack.
+/// Components are produced callees first.  Each component is also assigned a level:
+/// 0 if it calls nothing outside itself, otherwise one more than the highest level of
+/// any component it calls.  Components sharing a level never call each other, so a
+/// schedule that finishes each level before starting the next always has callee
+/// results available before any caller is analyzed.
+/// \param comps will hold the strongly connected components, callees first
+/// \param level will hold the level of each component
+void CallGraph::buildComponents(vector<vector<CallGraphNode *> > &comps,vector<int4> &level)
+
+{
+  map<CallGraphNode *,int4> nodeindex;
+  vector<CallGraphNode *> nodes;
+  map<Address,CallGraphNode>::iterator iter;
+  for(iter=graph.begin();iter!=graph.end();++iter) {
+    nodeindex[&(*iter).second] = nodes.size();
+    nodes.push_back(&(*iter).second);
+  }
+
+  int4 num = nodes.size();
+  vector<int4> order(num,-1);	// Discovery order, -1 if not yet visited
+  vector<int4> low(num,0);
+  vector<int4> comp(num,-1);	// Component of each node once it is assigned
+  vector<int4> stack;		// Tarjan's stack of nodes not yet assigned
+  vector<pair<int4,int4> > path; // DFS path: (node, next out edge)
+  int4 counter = 0;
+
+  comps.clear();
+  level.clear();
+  for(int4 root=0;root<num;++root) {
+    if (order[root] >= 0) continue;
+    path.push_back(pair<int4,int4>(root,0));
+    order[root] = low[root] = counter++;
+    stack.push_back(root);
+    while(!path.empty()) {
+      int4 cur = path.back().first;
+      int4 slot = path.back().second;
+      CallGraphNode *node = nodes[cur];
+      if (slot < node->outedge.size()) {
+	path.back().second += 1;
+	int4 next = nodeindex[node->outedge[slot].to];
+	if (order[next] < 0) {
+	  order[next] = low[next] = counter++;
+	  stack.push_back(next);
+	  path.push_back(pair<int4,int4>(next,0));
+	}
+	else if (comp[next] < 0) {	// Still on the stack
+	  if (order[next] < low[cur])
+	    low[cur] = order[next];
+	}
+	continue;
+      }
+      path.pop_back();
+      if (!path.empty()) {
+	int4 parent = path.back().first;
+	if (low[cur] < low[parent])
+	  low[parent] = low[cur];
+      }
+      if (low[cur] != order[cur]) continue;
+      // cur is the root of a component
+      int4 id = comps.size();
+      comps.push_back(vector<CallGraphNode *>());
+      int4 lev = 0;
+      int4 member;
+      do {
+	member = stack.back();
+	stack.pop_back();
+	comp[member] = id;
+	comps.back().push_back(nodes[member]);
+      } while(member != cur);
+      // Every component called from here has already been assigned a level
+      const vector<CallGraphNode *> &members( comps.back() );
+      for(int4 i=0;i<members.size();++i) {
+	for(int4 j=0;j<members[i]->outedge.size();++j) {
+	  int4 callee = comp[ nodeindex[members[i]->outedge[j].to] ];
+	  if (callee != id && level[callee] + 1 > lev)
+	    lev = level[callee] + 1;
+	}
+      }
+      level.push_back(lev);
+    }
+  }
+}
+
+void CallGraph::buildAllNodes(void)
+
+{
+  Scope *globscope = glb->symboltab->getGlobalScope();
+  iterateScopesRecursive(globscope);
+}
+
+/// The function must already have been through flow analysis, so that its call
+/// specifications are available.
+/// \param fd is the calling function
+void CallGraph::buildEdges(Funcdata *fd)
+
+{
+  CallGraphNode *fdnode = findNode(fd->getAddress());
+  if (fdnode == (CallGraphNode *)0)
+    throw LowlevelError("Function is missing from callgraph");
+  if (fd->getFuncProto().getModelExtraPop() == ProtoModel::extrapop_unknown)
+    fd->fillinExtrapop();
+
+  int4 numcalls = fd->numCalls();
+  for(int4 i=0;i<numcalls;++i) {
+    FuncCallSpecs *fs = fd->getCallSpecs(i);
+    Address addr = fs->getEntryAddress();
+    if (!addr.isInvalid()) {
+      CallGraphNode *tonode = findNode(addr);
+      if (tonode == (CallGraphNode *)0) {
+	string name;
+	glb->nameFunction(addr,name);
+	tonode = addNode(addr,name);
+      }
+      addEdge(fdnode,tonode,fs->getOp()->getAddr());
+    }
+  }
+}
+
+void CallGraph::saveXml(ostream &s) const
+
+{
+  s << "<callgraph>\n";
+
+  map<Address,CallGraphNode>::const_iterator iter;
+  for(iter=graph.begin();iter!=graph.end();++iter)
+    (*iter).second.saveXml(s);
+
+  // Dump all the "in" edges
+  for(iter=graph.begin();iter!=graph.end();++iter) {
+    const CallGraphNode &node( (*iter).second );
+    for(uint4 i=0;i<node.inedge.size();++i)
+      node.inedge[i].saveXml(s);
+  }
+
+  s << "</callgraph>\n";
+}
+
+void CallGraph::restoreXml(const Element *el)
+
+{
+  const List &list(el->getChildren());
+  List::const_iterator iter;
+  for(iter=list.begin();iter!=list.end();++iter) {
+    const Element *subel = *iter;
+    if (subel->getName() == "node")
+      CallGraphNode::restoreXml(subel,this);
+    else
+      CallGraphEdge::restoreXml(subel,this);
+  }
+}
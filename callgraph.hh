@@ -112,6 +112,7 @@ public:
   void deleteInEdge(CallGraphNode *node,int4 i);
   CallGraphNode * initLeafWalk(void);
   CallGraphNode *nextLeaf(CallGraphNode *node);
+  void buildComponents(vector<vector<CallGraphNode *> > &comps,vector<int4> &level);	// Strongly connected components, callees first
   map<Address,CallGraphNode>::iterator begin(void) { return graph.begin(); }
   map<Address,CallGraphNode>::iterator end(void) { return graph.end(); }
   void buildAllNodes(void);
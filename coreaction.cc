@@ -2076,7 +2076,13 @@ int4 ActionDefaultParams::apply(Funcdata &data)
       Funcdata *otherfunc = fc->getFuncdata();
       
       if (otherfunc != (Funcdata *)0) {
-	fc->copy(otherfunc->getFuncProto());
+	const FuncProto *cached = (const FuncProto *)0;
+	if (!otherfunc->getFuncProto().isInputLocked())	// Reuse a prototype recovered by earlier analysis
+	  cached = data.getArch()->protocache->find(*otherfunc);
+	if (cached != (const FuncProto *)0)
+	  fc->copy(*cached);	// Locked, so no trial analysis is needed at this call site
+	else
+	  fc->copy(otherfunc->getFuncProto());
 	if ((!fc->isModelLocked())&&(!fc->hasMatchingModel(evalfp)))
 	  fc->setModel(evalfp);
       }
@@ -3775,6 +3781,7 @@ int4 ActionDynamicMapping::apply(Funcdata &data)
   iter = localmap->beginDynamic();
   enditer = localmap->endDynamic();
   DynamicHash dhash;
+  dhash.setIndexing(true);	// Mapping only changes Varnode flags, not data-flow
   while(iter != enditer) {
     SymbolEntry *entry = &(*iter);
     ++iter;
@@ -3792,6 +3799,7 @@ int4 ActionDynamicSymbols::apply(Funcdata &data)
   iter = localmap->beginDynamic();
   enditer = localmap->endDynamic();
   DynamicHash dhash;
+  dhash.setIndexing(true);	// Attaching symbols doesn't change data-flow
   while(iter != enditer) {
     const SymbolEntry &entry( *iter );
     ++iter;
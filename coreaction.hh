@@ -602,7 +602,8 @@ public:
 /// \brief Find a prototype for each sub-function
 ///
 /// This loads prototype information, if it exists for each sub-function. If no explicit
-/// prototype exists, a default is selected.  If the prototype model specifies
+/// prototype exists, one recovered by earlier analysis of the sub-function is taken from
+/// the ProtoCache, otherwise a default is selected.  If the prototype model specifies
 /// \e uponreturn injection, the p-code is injected at this time.
 class ActionDefaultParams : public Action {
 public:
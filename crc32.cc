@@ -70,3 +70,21 @@ uint4 crc32tab[] = {
   0x54de5729,0x23d967bf,0xb3667a2e,0xc4614ab8,0x5d681b02,
   0x2a6f2b94,0xb40bbe37,0xc30c8ea1,0x5a05df1b,0x2d02ef8d };
 
+// Slicing-by-8 tables, crc32slice[k][i] is the register after feeding byte i followed by k zero bytes
+uint4 crc32slice[8][256];
+
+/// \brief Build the slicing tables from the bytewise table at start-up
+struct Crc32SliceInit {
+  Crc32SliceInit(void) {
+    for(int4 i=0;i<256;++i) {
+      uint4 reg = crc32tab[i];
+      crc32slice[0][i] = reg;
+      for(int4 k=1;k<8;++k) {
+	reg = crc32tab[reg & 0xff] ^ (reg >> 8);
+	crc32slice[k][i] = reg;
+      }
+    }
+  }
+};
+
+static Crc32SliceInit crc32sliceinit;
@@ -22,6 +22,7 @@
 #include "types.h"
 
 extern uint4 crc32tab[];	///< Table for quickly computing a 32-bit Cyclic Redundacy Check (CRC)
+extern uint4 crc32slice[8][256];	///< Tables for folding 4 or 8 bytes into the CRC at once (slicing-by-8)
 
 /// \brief Feed 8 bits into a CRC register
 ///
@@ -31,4 +32,33 @@ extern uint4 crc32tab[];	///< Table for quickly computing a 32-bit Cyclic Redund
 inline uint4 crc_update(uint4 reg,uint4 val) {
   return crc32tab[(reg ^ val)&0xff] ^ (reg>>8); }
 
+/// \brief Feed the low bytes of a value into a CRC register, least significant byte first
+///
+/// The result is identical to calling crc_update() on each byte in turn, but 4 and 8 byte
+/// values are folded in with one table lookup per byte and no serial dependency between lookups.
+/// \param reg is the current state of the CRC register
+/// \param val holds the bytes to feed in
+/// \param sz is the number of bytes (from the least significant end) to feed in
+/// \return the new value of the register
+inline uint4 crc_update_bytes(uint4 reg,uintb val,int4 sz) {
+  if (sz == 8) {
+    uint4 lo = reg ^ (uint4)val;
+    uint4 hi = (uint4)(val >> 32);
+    return crc32slice[7][lo & 0xff] ^ crc32slice[6][(lo>>8) & 0xff] ^
+      crc32slice[5][(lo>>16) & 0xff] ^ crc32slice[4][lo>>24] ^
+      crc32slice[3][hi & 0xff] ^ crc32slice[2][(hi>>8) & 0xff] ^
+      crc32slice[1][(hi>>16) & 0xff] ^ crc32slice[0][hi>>24];
+  }
+  if (sz == 4) {
+    uint4 lo = reg ^ (uint4)val;
+    return crc32slice[3][lo & 0xff] ^ crc32slice[2][(lo>>8) & 0xff] ^
+      crc32slice[1][(lo>>16) & 0xff] ^ crc32slice[0][lo>>24];
+  }
+  for(int4 i=0;i<sz;++i) {
+    reg = crc_update(reg,(uint4)val);
+    val >>= 8;
+  }
+  return reg;
+}
+
 #endif
@@ -1762,14 +1762,14 @@ void ScopeInternal::removeSymbol(Symbol *symbol)
       rangemap->erase( *iter );
     }
   }
-  nametree.erase(symbol);
+  eraseNameTree(symbol);
   delete symbol;
 }
 
 void ScopeInternal::renameSymbol(Symbol *sym,const string &newname)
 
 {
-  nametree.erase(sym);		// Erase under old name 
+  eraseNameTree(sym);		// Erase under old name 
   string oldname = sym->name;
   sym->name = newname;
   insertNameTree(sym);
@@ -2318,6 +2318,34 @@ void ScopeInternal::insertNameTree(Symbol *sym)
     if (!nameres.second)
       throw LowlevelError("Could  not deduplicate symbol: "+sym->name);
   }
+  pair<SymbolNameHash::iterator,bool> hashres;
+  hashres = namehash.insert(pair<string,SymbolNameTree::iterator>(sym->name,nameres.first));
+  if (!hashres.second) {	// Other symbols with this name exist
+    if (sym->nameDedup < (*(*hashres.first).second)->nameDedup)
+      (*hashres.first).second = nameres.first;	// New symbol is now first in the ordering
+  }
+}
+
+/// \brief Remove a Symbol from the \b nametree
+///
+/// If the Symbol is the first with its name, the \b namehash entry is moved to the next
+/// Symbol with the same name, or removed if there is none.
+/// \param sym is the Symbol to remove
+void ScopeInternal::eraseNameTree(Symbol *sym)
+
+{
+  SymbolNameTree::iterator iter = nametree.find(sym);
+  if (iter == nametree.end()) return;
+  SymbolNameHash::iterator hashiter = namehash.find(sym->name);
+  if (hashiter != namehash.end() && (*hashiter).second == iter) {
+    SymbolNameTree::iterator nextiter = iter;
+    ++nextiter;
+    if (nextiter != nametree.end() && (*nextiter)->name == sym->name)
+      (*hashiter).second = nextiter;
+    else
+      namehash.erase(hashiter);
+  }
+  nametree.erase(iter);
 }
 
 /// \brief Find an iterator pointing to the first Symbol in the ordering with a given name
@@ -2327,12 +2355,10 @@ void ScopeInternal::insertNameTree(Symbol *sym)
 SymbolNameTree::const_iterator ScopeInternal::findFirstByName(const string &name) const
 
 {
-  Symbol sym((Scope *)0,name,(Datatype *)0);
-  SymbolNameTree::const_iterator iter = nametree.lower_bound(&sym);
-  if (iter == nametree.end()) return iter;
-  if ((*iter)->getName() != name)
+  SymbolNameHash::const_iterator iter = namehash.find(name);
+  if (iter == namehash.end())
     return nametree.end();
-  return iter;
+  return (*iter).second;
 }
 
 void ScopeInternal::restoreXml(const Element *el)
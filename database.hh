@@ -26,6 +26,7 @@
 #include "variable.hh"
 #include "partmap.hh"
 #include "rangemap.hh"
+#include <unordered_map>
 
 class Architecture;
 class Funcdata;
@@ -308,6 +309,7 @@ public:
   }
 };
 typedef set<Symbol *,SymbolCompareName> SymbolNameTree;		///< A set of Symbol objects sorted by name
+typedef unordered_map<string,SymbolNameTree::iterator> SymbolNameHash;	///< Map from name to the first Symbol with that name
 
 /// \brief An iterator over SymbolEntry objects in multiple address spaces
 ///
@@ -687,11 +689,13 @@ public:
 ///
 /// This can act as a stand-alone Scope object or serve as an in-memory cache for
 /// another implementation.  This implements a \b nametree, which is a
-/// a set of Symbol objects (the set owns the Symbol objects). It also implements
-/// a \b maptable, which is a list of rangemaps that own the SymbolEntry objects.
+/// a set of Symbol objects (the set owns the Symbol objects). The \b namehash
+/// indexes the \b nametree by name, so exact name queries don't walk the tree.
+/// It also implements a \b maptable, which is a list of rangemaps that own the SymbolEntry objects.
 class ScopeInternal : public Scope {
   void processHole(const Element *el);
   void insertNameTree(Symbol *sym);
+  void eraseNameTree(Symbol *sym);
   SymbolNameTree::const_iterator findFirstByName(const string &name) const;
 protected:
   virtual void addSymbolInternal(Symbol *sym);
@@ -699,6 +703,7 @@ protected:
   virtual SymbolEntry *addDynamicMapInternal(Symbol *sym,uint4 exfl,uint8 hash,int4 off,int4 sz,
 					     const RangeList &uselim);
   SymbolNameTree nametree;			///< The set of Symbol objects, sorted by name
+  SymbolNameHash namehash;			///< Hashed index into \b nametree by name
   vector<EntryMap *> maptable;			///< Rangemaps of SymbolEntry, one map for each address space
   vector<vector<Symbol *> > category;		///< References to Symbol objects organized by category
   list<SymbolEntry> dynamicentry;		///< Dynamic symbol entries
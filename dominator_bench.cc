@@ -0,0 +1,189 @@
+/* ###
+ * IP: GHIDRA
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Standalone benchmark comparing the two forward dominator algorithms of BlockGraph.
+//
+//   dominator_bench [seed]
+//
+// Synthetic control-flow graphs (random, irreducible, and flattened state machines) of 100, 2000
+// and 20000 blocks are labeled with structureLoops() as Funcdata::structureReset() does.  Then
+// calcForwardDominator() is timed with the iterative algorithm and with calcDominatorSemiNCA(),
+// selected through BlockGraph::dominatorThreshold.  The immediate dominator of every block must
+// be identical, and the program exits with 1 if any differ.
+
+#include "block.hh"
+#include <iostream>
+#include <ctime>
+
+/// \brief A synthetic control-flow graph, as a list of edges between numbered blocks
+struct BenchGraph {
+  string name;				///< Description of the graph
+  int4 size;				///< Number of blocks
+  vector<pair<int4,int4> > edges;	///< Edges, block 0 is the entry
+};
+
+static uint4 benchSeed;			///< State of the random number generator
+
+/// \param range is the number of values to choose from
+/// \return a pseudo-random value in [0,range)
+static int4 benchRandom(int4 range)
+
+{
+  benchSeed = benchSeed * 1103515245 + 12345;
+  return (benchSeed >> 8) % range;
+}
+
+/// Every block falls through to the next one, and also branches to a random block, so a
+/// third or so of the branches go backwards.
+/// \param size is the number of blocks
+/// \param graph will hold the generated graph
+static void buildRandom(int4 size,BenchGraph &graph)
+
+{
+  ostringstream s;
+  s << "random " << dec << size;
+  graph.name = s.str();
+  graph.size = size;
+  for(int4 i=0;i<size-1;++i) {
+    graph.edges.push_back(pair<int4,int4>(i,i+1));
+    int4 target = benchRandom(size);
+    if (target != i+1)
+      graph.edges.push_back(pair<int4,int4>(i,target));
+  }
+}
+
+/// A chain of loops that can each be entered at either of two blocks, with random extra
+/// edges between the loops.
+/// \param loops is the number of loops
+/// \param graph will hold the generated graph
+static void buildIrreducible(int4 loops,BenchGraph &graph)
+
+{
+  ostringstream s;
+  s << "irreducible " << dec << loops*3+1;
+  graph.name = s.str();
+  graph.size = loops*3+1;
+  for(int4 i=0;i<loops;++i) {
+    int4 head = i*3;
+    graph.edges.push_back(pair<int4,int4>(head,head+1));	// Two entries into the cycle
+    graph.edges.push_back(pair<int4,int4>(head,head+2));
+    graph.edges.push_back(pair<int4,int4>(head+1,head+2));
+    graph.edges.push_back(pair<int4,int4>(head+2,head+1));
+    graph.edges.push_back(pair<int4,int4>(head+1,head+3));	// Exit to the next loop
+    if (benchRandom(4) == 0)
+      graph.edges.push_back(pair<int4,int4>(head+2,benchRandom(loops)*3+1));
+  }
+}
+
+/// A flattened state machine: a dispatcher branches to every state, and every state
+/// branches back to the dispatcher or to one of a few other states.
+/// \param states is the number of states
+/// \param graph will hold the generated graph
+static void buildStateMachine(int4 states,BenchGraph &graph)
+
+{
+  ostringstream s;
+  s << "state machine " << dec << states+2;
+  graph.name = s.str();
+  graph.size = states+2;
+  graph.edges.push_back(pair<int4,int4>(0,1));
+  for(int4 i=0;i<states;++i) {
+    int4 bl = i+2;
+    graph.edges.push_back(pair<int4,int4>(1,bl));
+    if (benchRandom(2) == 0)
+      graph.edges.push_back(pair<int4,int4>(bl,1));
+    else
+      graph.edges.push_back(pair<int4,int4>(bl,benchRandom(states)+2));
+  }
+}
+
+/// \brief Build the graph, then time the dominator calculation with one algorithm
+///
+/// \param graph is the graph to build
+/// \param threshold is the BlockGraph::dominatorThreshold selecting the algorithm
+/// \param reps is the number of times to repeat the calculation
+/// \param idom will hold the number of the immediate dominator of each block (-1 for none)
+/// \return the average time of one calculation in seconds
+static double runDominator(const BenchGraph &graph,uint4 threshold,int4 reps,vector<int4> &idom)
+
+{
+  BlockGraph bblocks;
+  vector<FlowBlock *> blocks;
+  for(int4 i=0;i<graph.size;++i)
+    blocks.push_back(bblocks.newBlock());
+  for(uint4 i=0;i<graph.edges.size();++i)
+    bblocks.addEdge(blocks[graph.edges[i].first],blocks[graph.edges[i].second]);
+  bblocks.setStartBlock(blocks[0]);
+  vector<FlowBlock *> rootlist;
+  bblocks.structureLoops(rootlist);
+
+  uint4 oldthreshold = BlockGraph::dominatorThreshold;
+  BlockGraph::dominatorThreshold = threshold;
+  clock_t start = clock();
+  for(int4 i=0;i<reps;++i)
+    bblocks.calcForwardDominator(rootlist);
+  double secs = (double)(clock() - start) / CLOCKS_PER_SEC / reps;
+  BlockGraph::dominatorThreshold = oldthreshold;
+
+  map<FlowBlock *,int4> number;	// structureLoops() reorders the blocks, so map back to the original numbering
+  for(int4 i=0;i<graph.size;++i)
+    number[blocks[i]] = i;
+  idom.resize(graph.size);
+  for(int4 i=0;i<graph.size;++i) {
+    map<FlowBlock *,int4>::const_iterator iter = number.find(blocks[i]->getImmedDom());
+    idom[i] = (iter == number.end()) ? -1 : (*iter).second;
+  }
+  return secs;
+}
+
+int main(int argc,char **argv)
+
+{
+  benchSeed = (argc > 1) ? atoi(argv[1]) : 1;
+  vector<BenchGraph> graphs;
+  int4 sizes[] = { 100, 2000, 20000 };
+  for(int4 i=0;i<3;++i) {
+    graphs.push_back(BenchGraph());
+    buildRandom(sizes[i],graphs.back());
+    graphs.push_back(BenchGraph());
+    buildIrreducible(sizes[i]/3,graphs.back());
+    graphs.push_back(BenchGraph());
+    buildStateMachine(sizes[i]-2,graphs.back());
+  }
+
+  int4 mismatches = 0;
+  cout << "graph                   iterative     semi-nca" << endl;
+  for(uint4 i=0;i<graphs.size();++i) {
+    const BenchGraph &graph( graphs[i] );
+    int4 reps = (graph.size >= 20000) ? 3 : 20;
+    vector<int4> iterdom,semidom;
+    double itersecs = runDominator(graph,~((uint4)0),reps,iterdom);
+    double semisecs = runDominator(graph,0,reps,semidom);
+    cout << graph.name;
+    for(int4 j=graph.name.size();j<22;++j)
+      cout << ' ';
+    cout << "  " << fixed << itersecs*1000.0 << "ms  " << semisecs*1000.0 << "ms" << endl;
+    for(int4 j=0;j<graph.size;++j) {
+      if (iterdom[j] != semidom[j]) {
+	cout << "MISMATCH: " << graph.name << " block " << dec << j << " idom " << iterdom[j] << " vs " << semidom[j] << endl;
+	mismatches += 1;
+	break;
+      }
+    }
+  }
+  if (mismatches == 0)
+    cout << "immediate dominators match" << endl;
+  return (mismatches == 0) ? 0 : 1;
+}
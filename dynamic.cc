@@ -91,13 +91,8 @@ uint4 ToOpEdge::hash(uint4 reg) const
 {
   reg = crc_update(reg,(uint4)slot);
   reg = crc_update(reg,DynamicHash::transtable[op->code()]);
-  uintb val = op->getSeqNum().getAddr().getOffset();
-  int4 sz = op->getSeqNum().getAddr().getAddrSize();
-  for(int4 i=0;i<sz;++i) {
-    reg = crc_update(reg,(uint4)val); // Hash in the address
-    val >>= 8;
-  }
-  return reg;
+  const Address &addr( op->getSeqNum().getAddr() );
+  return crc_update_bytes(reg,addr.getOffset(),addr.getAddrSize()); // Hash in the address
 }
 
 /// When building the edge, certain p-code ops (CAST) are effectively ignored so that
@@ -196,6 +191,41 @@ void DynamicHash::clear(void)
   opedge.clear();
 }
 
+/// While the index is enabled, the hash of each Varnode and method is calculated once
+/// and remembered, so repeated uniqueness checks and lookups against the same candidates
+/// are a table probe. The caller must guarantee the data-flow (ops, their addresses,
+/// and the slots and sizes of their Varnodes) does not change while the index is enabled.
+/// Changing the flags, data-types, or symbols attached to Varnodes is fine.
+/// \param val is \b true to enable the index, \b false to disable and release it
+void DynamicHash::setIndexing(bool val)
+
+{
+  useindex = val;
+  hashindex.clear();
+}
+
+/// If indexing is enabled, look up the hash before calculating it, and record it after.
+/// \param vn is the Varnode to hash
+/// \param method is the hashing method to use
+/// \return the hash value
+uint8 DynamicHash::probeHash(const Varnode *vn,uint4 method)
+
+{
+  if (!useindex) {
+    clear();
+    calcHash(vn,method);
+    return hash;
+  }
+  pair<map<pair<const Varnode *,uint4>,uint8>::iterator,bool> res;
+  res = hashindex.insert(pair<pair<const Varnode *,uint4>,uint8>(pair<const Varnode *,uint4>(vn,method),0));
+  if (res.second) {
+    clear();
+    calcHash(vn,method);
+    (*res.first).second = hash;
+  }
+  return (*res.first).second;
+}
+
 /// A sub-graph is formed extending from the given Varnode as the root. The
 /// method specifies how the sub-graph is extended. In particular:
 ///  - Method 0 is extends to just immediate p-code ops reading or writing root
@@ -270,13 +300,8 @@ void DynamicHash::calcHash(const Varnode *root,uint4 method)
 
   // Hash in information about the root
   reg = crc_update(reg,(uint4)root->getSize());
-  if (root->isConstant()) {
-    uintb val = root->getOffset();
-    for(int4 i=0;i<root->getSize();++i) {
-      reg = crc_update(reg,(uint4)val);
-      val >>= 8;
-    }
-  }
+  if (root->isConstant())
+    reg = crc_update_bytes(reg,root->getOffset(),root->getSize());
 
   for(uint4 i=0;i<opedge.size();++i)
     reg = opedge[i].hash(reg);
@@ -344,14 +369,14 @@ void DynamicHash::uniqueHash(const Varnode *root,Funcdata *fd)
     if (hash == 0) return;	// Can't get a good hash
     tmphash = hash;
     tmpaddr = addrresult;
+    if (useindex)
+      hashindex[pair<const Varnode *,uint4>(root,method)] = tmphash;
     vnlist.clear();
     vnlist2.clear();
     gatherFirstLevelVars(vnlist,fd,tmpaddr,tmphash);
     for(uint4 i=0;i<vnlist.size();++i) {
       Varnode *tmpvn = vnlist[i];
-      clear();
-      calcHash(tmpvn,method);
-      if (hash == tmphash) {	// Hash collision
+      if (probeHash(tmpvn,method) == tmphash) {	// Hash collision
 	vnlist2.push_back(tmpvn);
 	if (vnlist2.size()>maxduplicates) break;
       }
@@ -405,9 +430,7 @@ Varnode *DynamicHash::findVarnode(Funcdata *fd,const Address &addr,uint8 h)
   gatherFirstLevelVars(vnlist,fd,addr,h);
   for(uint4 i=0;i<vnlist.size();++i) {
     Varnode *tmpvn = vnlist[i];
-    clear();
-    calcHash(tmpvn,method);
-    if (hash == h)
+    if (probeHash(tmpvn,method) == h)
       vnlist2.push_back(tmpvn);
   }
   if (total != vnlist2.size()) return (Varnode *)0;
@@ -69,13 +69,18 @@ class DynamicHash {
 
   Address addrresult;			///< Address most closely associated with variable
   uint8 hash;				///< The calculated hash value
+  bool useindex;			///< \b true if hashes of candidate Varnodes are remembered
+  map<pair<const Varnode *,uint4>,uint8> hashindex;	///< Hash of each (Varnode,method) seen while indexing
   void buildVnUp(const Varnode *vn);	///< Add in the edge between the given Varnode and its defining PcodeOp
   void buildVnDown(const Varnode *vn);	///< Add in edges between the given Varnode and any PcodeOp that reads it
   void buildOpUp(const PcodeOp *op);	///< Move input Varnodes for the given PcodeOp into staging
   void buildOpDown(const PcodeOp *op);	///< Move the output Varnode for the given PcodeOp into staging
   void gatherUnmarkedVn(void);		///< Move staged Varnodes into the sub-graph and mark them
   void gatherUnmarkedOp(void);		///< Mark any new PcodeOps in the sub-graph
+  uint8 probeHash(const Varnode *vn,uint4 method);	///< Get the hash of a candidate Varnode, using the index if enabled
 public:
+  DynamicHash(void) { hash = 0; useindex = false; }	///< Constructor
+  void setIndexing(bool val);		///< Enable or disable the (Varnode,method) hash index
   void clear(void);			///< Called for each additional hash (after the first)
   void calcHash(const Varnode *root,uint4 method);	///< Calculate the hash for given Varnode and method
   void uniqueHash(const Varnode *root,Funcdata *fd);	///< Select a unique hash for the given Varnode
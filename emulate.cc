@@ -118,7 +118,13 @@ VarnodeData *PcodeEmitCache::createVarnode(const VarnodeData *var)
   return res;
 }
 
-void PcodeEmitCache::dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
+/// Build a PcodeOpRaw from the raw data and append it to the cache.
+/// \param addr is the address of the machine instruction
+/// \param opc is the op-code
+/// \param outvar is the output varnode or \e null
+/// \param vars is the array of input varnodes
+/// \param isize is the number of inputs
+void PcodeEmitCache::cacheOp(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
 
 {
   PcodeOpRaw *op = new PcodeOpRaw();
@@ -136,6 +142,32 @@ void PcodeEmitCache::dump(const Address &addr,OpCode opc,VarnodeData *outvar,Var
   }
 }
 
+void PcodeEmitCache::dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
+
+{
+  cacheOp(addr,opc,outvar,vars,isize);
+}
+
+/// The caches are sized once for the whole instruction, and each op is built
+/// directly from the translator's array without a virtual call per op.
+/// \param addr is the address of the machine instruction
+/// \param ops is the contiguous array of p-code ops
+/// \param numops is the number of ops
+void PcodeEmitCache::dumpBlock(const Address &addr,const PcodeData *ops,int4 numops)
+
+{
+  int4 numvars = 0;
+  for(int4 i=0;i<numops;++i) {
+    numvars += ops[i].isize;
+    if (ops[i].outvar != (VarnodeData *)0)
+      numvars += 1;
+  }
+  opcache.reserve(opcache.size() + numops);
+  varcache.reserve(varcache.size() + numvars);
+  for(int4 i=0;i<numops;++i)
+    cacheOp(addr,ops[i].opc,ops[i].outvar,ops[i].invar,ops[i].isize);
+}
+
 /// This method executes a single pcode operation, the current one (returned by getCurrentOp()).
 /// The MemoryState of the emulator is queried and changed as needed to accomplish this.
 void Emulate::executeCurrentOp(void)
@@ -454,3 +486,454 @@ void EmulatePcodeCache::executeInstruction(void)
     executeCurrentOp();
   } while(!instruction_start);
 }
+
+FastInstruction::~FastInstruction(void)
+
+{
+  for(int4 i=0;i<rawops.size();++i)
+    delete rawops[i];
+  for(int4 i=0;i<rawvars.size();++i)
+    delete rawvars[i];
+}
+
+/// The \e register and \e unique spaces must already have memory banks registered with the
+/// MemoryState.  These are overlayed with flat banks for the duration of the emulator.
+/// \param t is the SLEIGH translator
+/// \param s is the MemoryState the emulator should manipulate
+/// \param b is the table of breakpoints the emulator should invoke
+EmulateFast::EmulateFast(Translate *t,MemoryState *s,BreakTable *b)
+  : EmulateMemory(s)
+{
+  trans = t;
+  OpBehavior::registerInstructions(inst,t);
+  breaktable = b;
+  breaktable->setEmulate(this);
+  current = (FastInstruction *)0;
+  regbank = (MemoryFlatOverlay *)0;
+  uniqbank = (MemoryFlatOverlay *)0;
+
+  AddrSpace *regspace = trans->getSpaceByName("register");
+  if (regspace != (AddrSpace *)0) {
+    map<VarnodeData,string> reglist;
+    trans->getAllRegisters(reglist);
+    uintb regsize = 0;
+    map<VarnodeData,string>::const_iterator iter;
+    for(iter=reglist.begin();iter!=reglist.end();++iter) {
+      const VarnodeData &vn((*iter).first);
+      if (vn.space != regspace) continue;
+      if (vn.offset + vn.size > regsize)
+	regsize = vn.offset + vn.size;
+    }
+    if (regsize > 0x100000)		// Don't let a sparse register layout blow up the array
+      regsize = 0x100000;
+    regbank = installFlatBank(regspace,regsize);
+  }
+  uintb uniqsize = trans->getUniqueBase();
+  if (uniqsize > 0x100000)
+    uniqsize = 0x100000;
+  uniqbank = installFlatBank(trans->getUniqueSpace(),uniqsize);
+}
+
+EmulateFast::~EmulateFast(void)
+
+{
+  clearTranslations();
+  restoreBank(uniqbank);
+  restoreBank(regbank);
+  for(int4 i=0;i<inst.size();++i) {
+    OpBehavior *t_op = inst[i];
+    if (t_op != (OpBehavior *)0)
+      delete t_op;
+  }
+}
+
+/// The bank currently registered for the space becomes the \e underlying bank of the overlay,
+/// and provides the initial contents of the flat array.
+/// \param spc is the address space to overlay
+/// \param sz is the number of bytes to hold in the flat array
+/// \return the new flat bank
+MemoryFlatOverlay *EmulateFast::installFlatBank(AddrSpace *spc,uintb sz)
+
+{
+  MemoryBank *orig = memstate->getMemoryBank(spc);
+  if (orig == (MemoryBank *)0)
+    throw LowlevelError("Fast emulator requires a memory bank for space: "+spc->getName());
+  MemoryFlatOverlay *bank = new MemoryFlatOverlay(spc,orig->getWordSize(),orig->getPageSize(),sz,orig);
+  memstate->setMemoryBank(bank);
+  return bank;
+}
+
+/// The words of the flat array that were changed are written back to the \e underlying bank,
+/// which is registered with the MemoryState again.  This runs from the destructor, so a failure
+/// in the underlying bank (a full hash table, for instance) is not propagated; the words that
+/// could not be written back are lost.
+/// \param bank is the flat bank to remove
+void EmulateFast::restoreBank(MemoryFlatOverlay *bank)
+
+{
+  if (bank == (MemoryFlatOverlay *)0) return;
+  memstate->setMemoryBank(bank->getUnderlie());
+  try {
+    bank->writeBack();
+  }
+  catch(LowlevelError &err) {
+  }
+  delete bank;
+}
+
+/// Translations must be thrown away if the code being emulated is modified, or if the
+/// context that drives its translation changes.
+void EmulateFast::clearTranslations(void)
+
+{
+  map<Address,FastInstruction *>::iterator iter;
+  for(iter=translated.begin();iter!=translated.end();++iter)
+    delete (*iter).second;
+  translated.clear();
+  current = (FastInstruction *)0;
+}
+
+/// \param slot is the operand slot to fill in
+/// \param vn is the raw varnode being resolved
+void EmulateFast::resolveSlot(FastSlot &slot,const VarnodeData *vn) const
+
+{
+  slot.size = vn->size;
+  slot.space = vn->space;
+  slot.offset = vn->offset;
+  slot.bigendian = vn->space->isBigEndian();
+  slot.ptr = (uint1 *)0;
+  if (vn->space->getType() == IPTR_CONSTANT) {
+    slot.kind = FastSlot::slot_constant;
+    return;
+  }
+  const MemoryFlatOverlay *bank = (const MemoryFlatOverlay *)0;
+  if (vn->space == trans->getUniqueSpace())
+    bank = uniqbank;
+  else if (regbank != (MemoryFlatOverlay *)0 && vn->space == regbank->getSpace())
+    bank = regbank;
+  if (bank != (const MemoryFlatOverlay *)0 && vn->offset + vn->size <= bank->getDataSize()) {
+    slot.kind = FastSlot::slot_flat;
+    slot.ptr = bank->getData() + vn->offset;
+    return;
+  }
+  slot.kind = FastSlot::slot_memory;
+}
+
+/// The handler is chosen from the op-code, and each operand is resolved to its storage.
+/// Relative branch targets are checked against the size of the instruction.
+/// \param op is the FastOp to fill in
+/// \param raw is the raw op being decoded
+void EmulateFast::decodeOp(FastOp &op,PcodeOpRaw *raw) const
+
+{
+  op.raw = raw;
+  op.behave = raw->getBehavior();
+  if (raw->getOutput() != (VarnodeData *)0)
+    resolveSlot(op.out,raw->getOutput());
+  int4 numin = raw->numInput();
+  if (numin > 3) numin = 3;
+  for(int4 i=0;i<numin;++i)
+    resolveSlot(op.in[i],raw->getInput(i));
+
+  if (op.behave == (OpBehavior *)0) {
+    op.handler = opUnsupported;
+    return;
+  }
+  switch(op.behave->getOpcode()) {
+  case CPUI_COPY:		op.handler = opCopy; break;
+  case CPUI_INT_ADD:		op.handler = opIntAdd; break;
+  case CPUI_INT_SUB:		op.handler = opIntSub; break;
+  case CPUI_INT_AND:		op.handler = opIntAnd; break;
+  case CPUI_INT_OR:		op.handler = opIntOr; break;
+  case CPUI_INT_XOR:		op.handler = opIntXor; break;
+  case CPUI_INT_EQUAL:		op.handler = opIntEqual; break;
+  case CPUI_INT_NOTEQUAL:	op.handler = opIntNotEqual; break;
+  case CPUI_INT_LESS:		op.handler = opIntLess; break;
+  case CPUI_INT_LESSEQUAL:	op.handler = opIntLessEqual; break;
+  case CPUI_INT_ZEXT:		op.handler = opIntZext; break;
+  case CPUI_BOOL_NEGATE:	op.handler = opBoolNegate; break;
+  case CPUI_LOAD:
+  case CPUI_STORE:
+    op.in[0].space = Address::getSpaceFromConst(raw->getInput(0)->getAddr());
+    op.handler = (op.behave->getOpcode() == CPUI_LOAD) ? opLoad : opStore;
+    break;
+  case CPUI_BRANCH:
+  case CPUI_CALL:
+    if (op.in[0].space->getType() == IPTR_CONSTANT) {
+      intb dest = (intb)op.in[0].offset;
+      sign_extend(dest,8*op.in[0].size-1);
+      op.in[0].offset = (uintb)dest;
+    }
+    op.handler = opBranch;
+    break;
+  case CPUI_CBRANCH:
+    if (op.in[0].space->getType() == IPTR_CONSTANT) {
+      intb dest = (intb)op.in[0].offset;
+      sign_extend(dest,8*op.in[0].size-1);
+      op.in[0].offset = (uintb)dest;
+    }
+    op.handler = opCbranch;
+    break;
+  case CPUI_BRANCHIND:
+  case CPUI_CALLIND:
+  case CPUI_RETURN:
+    op.handler = opBranchind;
+    break;
+  case CPUI_CALLOTHER:
+    op.handler = opCallother;
+    break;
+  default:
+    if (op.behave->isSpecial())
+      op.handler = opUnsupported;
+    else if (op.behave->isUnary())
+      op.handler = opUnary;
+    else
+      op.handler = opBinary;
+    break;
+  }
+}
+
+/// If the instruction has not been seen before, it is translated via SLEIGH, and each of
+/// its raw ops is pre-decoded.  The result is cached for later executions.
+/// \param addr is the address of the instruction
+/// \return the translated instruction
+FastInstruction *EmulateFast::translate(const Address &addr)
+
+{
+  map<Address,FastInstruction *>::iterator iter = translated.find(addr);
+  if (iter != translated.end())
+    return (*iter).second;
+  FastInstruction *res = new FastInstruction(addr);
+  try {
+    PcodeEmitCache emit(res->rawops,res->rawvars,inst,0);
+    res->length = trans->oneInstruction(emit,addr);
+  } catch(...) {
+    delete res;
+    throw;
+  }
+  int4 numops = res->rawops.size();
+  res->ops.resize(numops);
+  for(int4 i=0;i<numops;++i)
+    decodeOp(res->ops[i],res->rawops[i]);
+  translated[addr] = res;
+  return res;
+}
+
+/// \param addr is the address where execution should continue
+void EmulateFast::setExecuteAddress(const Address &addr)
+
+{
+  current_address = addr;
+  current = translate(current_address);
+}
+
+/// Single p-code stepping is not supported by this emulator
+void EmulateFast::fallthruOp(void)
+
+{
+  throw LowlevelError("EmulateFast can only step by machine instruction");
+}
+
+/// Address breakpoints are checked first, as with EmulatePcodeCache::executeInstruction().
+/// The op stream is then run by jumping directly through each op's handler.  On exit, the
+/// translation of the next instruction is established, following the cached fall-thru
+/// chain where possible.
+void EmulateFast::executeInstruction(void)
+
+{
+  if (breaktable->doAddressBreak(current_address))
+    return;
+  FastInstruction *curinst = current;
+  int4 numops = curinst->ops.size();
+  int4 index = 0;
+  if (numops != 0) {
+    const FastOp *ops = &curinst->ops[0];
+    do {
+      const FastOp &op(ops[index]);
+      index = (*op.handler)(this,op,index);
+    } while(index >= 0 && index < numops);
+    if (index > numops)
+      throw LowlevelError("Bad intra-instruction branch");
+  }
+  if (index == numops) {		// Fall-thru
+    if (curinst->fallthru == (FastInstruction *)0)
+      curinst->fallthru = translate(curinst->addr + curinst->length);
+    current = curinst->fallthru;
+    current_address = current->addr;
+  }
+  else
+    setExecuteAddress(branch_address);
+}
+
+int4 EmulateFast::opCopy(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,emu->getSlot(op.in[0]));
+  return index + 1;
+}
+
+int4 EmulateFast::opIntAdd(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  uintb res = emu->getSlot(op.in[0]) + emu->getSlot(op.in[1]);
+  emu->setSlot(op.out,res & calc_mask(op.out.size));
+  return index + 1;
+}
+
+int4 EmulateFast::opIntSub(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  uintb res = emu->getSlot(op.in[0]) - emu->getSlot(op.in[1]);
+  emu->setSlot(op.out,res & calc_mask(op.out.size));
+  return index + 1;
+}
+
+int4 EmulateFast::opIntAnd(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,emu->getSlot(op.in[0]) & emu->getSlot(op.in[1]));
+  return index + 1;
+}
+
+int4 EmulateFast::opIntOr(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,emu->getSlot(op.in[0]) | emu->getSlot(op.in[1]));
+  return index + 1;
+}
+
+int4 EmulateFast::opIntXor(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,emu->getSlot(op.in[0]) ^ emu->getSlot(op.in[1]));
+  return index + 1;
+}
+
+int4 EmulateFast::opIntEqual(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,(emu->getSlot(op.in[0]) == emu->getSlot(op.in[1])) ? 1 : 0);
+  return index + 1;
+}
+
+int4 EmulateFast::opIntNotEqual(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,(emu->getSlot(op.in[0]) != emu->getSlot(op.in[1])) ? 1 : 0);
+  return index + 1;
+}
+
+int4 EmulateFast::opIntLess(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,(emu->getSlot(op.in[0]) < emu->getSlot(op.in[1])) ? 1 : 0);
+  return index + 1;
+}
+
+int4 EmulateFast::opIntLessEqual(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,(emu->getSlot(op.in[0]) <= emu->getSlot(op.in[1])) ? 1 : 0);
+  return index + 1;
+}
+
+int4 EmulateFast::opIntZext(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,emu->getSlot(op.in[0]));
+  return index + 1;
+}
+
+int4 EmulateFast::opBoolNegate(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->setSlot(op.out,emu->getSlot(op.in[0]) ^ 1);
+  return index + 1;
+}
+
+int4 EmulateFast::opUnary(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  uintb in1 = emu->getSlot(op.in[0]);
+  emu->setSlot(op.out,op.behave->evaluateUnary(op.out.size,op.in[0].size,in1));
+  return index + 1;
+}
+
+int4 EmulateFast::opBinary(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  uintb in1 = emu->getSlot(op.in[0]);
+  uintb in2 = emu->getSlot(op.in[1]);
+  emu->setSlot(op.out,op.behave->evaluateBinary(op.out.size,op.in[0].size,in1,in2));
+  return index + 1;
+}
+
+int4 EmulateFast::opLoad(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  AddrSpace *spc = op.in[0].space;
+  uintb off = AddrSpace::addressToByte(emu->getSlot(op.in[1]),spc->getWordSize());
+  emu->setSlot(op.out,emu->memstate->getValue(spc,off,op.out.size));
+  return index + 1;
+}
+
+int4 EmulateFast::opStore(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  AddrSpace *spc = op.in[0].space;
+  uintb val = emu->getSlot(op.in[2]);
+  uintb off = AddrSpace::addressToByte(emu->getSlot(op.in[1]),spc->getWordSize());
+  emu->memstate->setValue(spc,off,op.in[2].size,val);
+  return index + 1;
+}
+
+/// A constant destination is a relative branch within the instruction, whose sign-extended
+/// displacement was computed at decode time.
+int4 EmulateFast::opBranch(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  if (op.in[0].kind == FastSlot::slot_constant && op.in[0].space->getType() == IPTR_CONSTANT) {
+    int4 dest = index + (int4)(intb)op.in[0].offset;
+    if (dest < 0)
+      throw LowlevelError("Bad intra-instruction branch");
+    return dest;
+  }
+  emu->branch_address = Address(op.in[0].space,op.in[0].offset);
+  return -1;
+}
+
+int4 EmulateFast::opCbranch(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  if (emu->getSlot(op.in[1]) == 0)
+    return index + 1;
+  return opBranch(emu,op,index);
+}
+
+int4 EmulateFast::opBranchind(EmulateFast *emu,const FastOp &op,int4)
+
+{
+  uintb off = emu->getSlot(op.in[0]);
+  emu->branch_address = Address(emu->current_address.getSpace(),off);
+  return -1;
+}
+
+/// The user-defined op is passed to the BreakTable, exactly as EmulatePcodeCache does.
+int4 EmulateFast::opCallother(EmulateFast *emu,const FastOp &op,int4 index)
+
+{
+  emu->currentOp = op.raw;
+  emu->currentBehave = op.behave;
+  if (!emu->breaktable->doPcodeOpBreak(op.raw))
+    throw LowlevelError("Userop not hooked");
+  return index + 1;
+}
+
+int4 EmulateFast::opUnsupported(EmulateFast *,const FastOp &op,int4)
+
+{
+  if (op.behave == (OpBehavior *)0)
+    throw LowlevelError("Unsupported p-code op in fast emulator");
+  throw LowlevelError("Unsupported p-code op in fast emulator: " + string(get_opname(op.behave->getOpcode())));
+}
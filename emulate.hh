@@ -281,10 +281,12 @@ class PcodeEmitCache : public PcodeEmit {
   const vector<OpBehavior *> &inst;	///< Array of behaviors for translating OpCode
   uintm uniq;				///< Starting offset for defining temporaries in \e unique space
   VarnodeData *createVarnode(const VarnodeData *var);	///< Clone and cache a raw VarnodeData
+  void cacheOp(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize);	///< Cache a single p-code op
 public:
   PcodeEmitCache(vector<PcodeOpRaw *> &ocache,vector<VarnodeData *> &vcache,
 		 const vector<OpBehavior *> &in,uintb uniqReserve);	///< Constructor
   virtual void dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize);
+  virtual void dumpBlock(const Address &addr,const PcodeData *ops,int4 numops);
 };
 
 /// \brief A SLEIGH based implementation of the Emulate interface
@@ -367,6 +369,139 @@ inline Address EmulatePcodeCache::getExecuteAddress(void) const
   return current_address;
 }
 
+class EmulateFast;		// Forward declaration
+
+/// \brief An operand of a pre-decoded p-code op, resolved to its storage
+///
+/// Constants carry their value directly.  Varnodes in the \e register and \e unique spaces
+/// that fall inside the emulator's flat banks are resolved to a byte pointer.  Everything else
+/// is accessed through the MemoryState.
+struct FastSlot {
+  enum {
+    slot_constant = 0,		///< Value is held directly in \b offset
+    slot_flat = 1,		///< Bytes live at \b ptr in a flat bank
+    slot_memory = 2		///< Bytes are accessed through the MemoryState
+  };
+  int4 kind;			///< The kind of storage
+  int4 size;			///< Number of bytes in the operand
+  bool bigendian;		///< Encoding of bytes for \e flat storage
+  uint1 *ptr;			///< Pointer to the bytes for \e flat storage
+  AddrSpace *space;		///< Address space for \e memory storage (or LOAD/STORE and branch targets)
+  uintb offset;			///< Constant value, or offset for \e memory storage
+};
+
+/// \brief A pre-decoded p-code op for the fast emulator
+///
+/// Each op carries a direct pointer to the routine that executes it, so the emulator
+/// dispatches straight from the op stream with no switch on the op-code.  A handler returns
+/// the index of the next op to execute within the instruction, or a negative value if
+/// control leaves the instruction.
+struct FastOp {
+  typedef int4 (*Handler)(EmulateFast *emu,const FastOp &op,int4 index);	///< Signature of an op handler
+  Handler handler;		///< Routine executing this op
+  OpBehavior *behave;		///< Behavior for generic unary and binary ops
+  PcodeOpRaw *raw;		///< The original raw op (for breakpoints)
+  FastSlot out;			///< The output operand (if present)
+  FastSlot in[3];		///< The first three input operands
+};
+
+/// \brief A machine instruction translated into a stream of FastOp objects
+struct FastInstruction {
+  Address addr;				///< Address of the machine instruction
+  int4 length;				///< Length of the instruction in bytes
+  vector<FastOp> ops;			///< The pre-decoded op stream
+  vector<PcodeOpRaw *> rawops;		///< Raw ops backing the stream
+  vector<VarnodeData *> rawvars;	///< Raw varnodes backing the stream
+  FastInstruction *fallthru;		///< Translation of the fall-thru instruction (once known)
+  FastInstruction(const Address &a) : addr(a) { length = 0; fallthru = (FastInstruction *)0; }	///< Constructor
+  ~FastInstruction(void);		///< Destructor
+};
+
+/// \brief A threaded-code emulator executing pre-decoded p-code
+///
+/// Each machine instruction is translated once into a FastInstruction, whose operands are resolved
+/// to constants, direct byte pointers, or MemoryState accesses.  Translations are cached by address,
+/// and fall-thru successors are chained, so straight-line code never revisits the cache.
+///
+/// The \e register and \e unique spaces are backed by MemoryFlatOverlay banks, which the emulator
+/// installs into the MemoryState over the banks already registered there.  The MemoryState stays
+/// coherent throughout, so breakpoints see the same machine state as with EmulatePcodeCache.  The
+/// original banks are updated and restored when the emulator is destroyed.
+///
+/// Execution is by whole machine instruction only; single p-code stepping is not supported.
+class EmulateFast : public EmulateMemory {
+  Translate *trans;		///< The SLEIGH translator
+  vector<OpBehavior *> inst;	///< Map from OpCode to OpBehavior
+  BreakTable *breaktable;	///< The table of breakpoints
+  map<Address,FastInstruction *> translated;	///< Cache of translated instructions
+  FastInstruction *current;	///< Translation of the current instruction
+  Address current_address;	///< Address of the current instruction
+  Address branch_address;	///< Destination of a branch leaving the current instruction
+  MemoryFlatOverlay *regbank;	///< Flat bank for the \e register space
+  MemoryFlatOverlay *uniqbank;	///< Flat bank for the \e unique space
+  MemoryFlatOverlay *installFlatBank(AddrSpace *spc,uintb sz);	///< Overlay a flat bank on the given space
+  void restoreBank(MemoryFlatOverlay *bank);	///< Write back and remove a flat bank
+  void resolveSlot(FastSlot &slot,const VarnodeData *vn) const;	///< Resolve a varnode to an operand slot
+  void decodeOp(FastOp &op,PcodeOpRaw *raw) const;	///< Pre-decode a single raw op
+  FastInstruction *translate(const Address &addr);	///< Get the (cached) translation of an instruction
+  uintb getSlot(const FastSlot &slot) const;		///< Read the value of an operand
+  void setSlot(const FastSlot &slot,uintb val);		///< Write the value of an operand
+  static int4 opCopy(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntAdd(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntSub(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntAnd(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntOr(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntXor(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntEqual(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntNotEqual(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntLess(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntLessEqual(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opIntZext(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opBoolNegate(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opUnary(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opBinary(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opLoad(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opStore(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opBranch(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opCbranch(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opBranchind(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opCallother(EmulateFast *emu,const FastOp &op,int4 index);
+  static int4 opUnsupported(EmulateFast *emu,const FastOp &op,int4 index);
+protected:
+  virtual void fallthruOp(void);
+public:
+  EmulateFast(Translate *t,MemoryState *s,BreakTable *b);	///< Fast emulator constructor
+  virtual ~EmulateFast(void);
+  void clearTranslations(void);		///< Throw away all cached translations
+  virtual void setExecuteAddress(const Address &addr);	///< Set current execution address
+  virtual Address getExecuteAddress(void) const { return current_address; }	///< Get current execution address
+  void executeInstruction(void);	///< Execute a single machine instruction
+};
+
+/// Values are encoded in the bank using the endianness of its space.
+/// \param slot is the operand to read
+/// \return the value of the operand
+inline uintb EmulateFast::getSlot(const FastSlot &slot) const
+
+{
+  if (slot.kind == FastSlot::slot_constant)
+    return slot.offset;
+  if (slot.kind == FastSlot::slot_flat)
+    return MemoryBank::constructValue(slot.ptr,slot.size,slot.bigendian);
+  return memstate->getValue(slot.space,slot.offset,slot.size);
+}
+
+/// \param slot is the operand to write
+/// \param val is the value to write
+inline void EmulateFast::setSlot(const FastSlot &slot,uintb val)
+
+{
+  if (slot.kind == FastSlot::slot_flat)
+    MemoryBank::deconstructValue(slot.ptr,val,slot.size,slot.bigendian);
+  else
+    memstate->setValue(slot.space,slot.offset,slot.size,val);
+}
+
 /** \page sleighAPIemulate The SLEIGH Emulator
     
   \section emu_overview Overview
@@ -381,6 +516,7 @@ inline Address EmulatePcodeCache::getExecuteAddress(void) const
     - \ref BreakCallBack
     - \ref Emulate
     - \ref EmulatePcodeCache
+    - \ref EmulateFast
 
   The MemoryState object holds the representation of registers and memory during emulation.  It
   understands the address spaces defined in the \b SLEIGH specification and how data is encoded
@@ -407,6 +543,10 @@ inline Address EmulatePcodeCache::getExecuteAddress(void) const
   to be stepped through an entire machine instruction at a time.  The single pcode stepping methods
   are of course still available and the two methods can be used together without conflict.
 
+  For bulk emulation, EmulateFast translates each instruction once into a stream of pre-decoded
+  ops, with operands resolved ahead of time and the \e register and \e unique spaces held in flat
+  arrays.  It only steps by whole machine instruction.
+
   \section emu_membuild Building a Memory State
 
   Assuming the SLEIGH Translate object and the LoadImage object have already been built
@@ -0,0 +1,166 @@
+/* ###
+ * IP: GHIDRA
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Standalone benchmark comparing EmulatePcodeCache with EmulateFast over the same code.
+//
+//   emulate_bench <file.sla> <binary> <base> <entry> [count] [name=value ...]
+//
+// The raw binary is mapped at <base>, and each emulator runs up to <count> machine
+// instructions from <entry>.  Optional name=value pairs set context variables (e.g. addrsize=1
+// opsize=1 for 32-bit x86).  Memory is read through a MemoryPageTable over the image, and the
+// register banks of the two runs are compared at the end.
+
+#include "sleigh.hh"
+#include "emulate.hh"
+#include <iostream>
+#include <ctime>
+
+static Address parseAddress(Translate &trans,const char *str)
+
+{
+  return Address(trans.getDefaultSpace(),strtoull(str,(char **)0,16));
+}
+
+/// \brief The machine state of one benchmark run
+struct BenchState {
+  MemoryImage image;		///< Bytes of the load image
+  MemoryPageTable ram;		///< Writable memory over the image
+  MemoryHashOverlay reg;	///< The \e register space
+  MemoryHashOverlay uniq;	///< The \e unique space
+  MemoryState memstate;		///< State seen by the emulator
+  BenchState(Translate &trans,LoadImage *loader);	///< Construct a fresh state
+};
+
+/// \param trans is the translator for the processor
+/// \param loader is the image mapped into the default space
+BenchState::BenchState(Translate &trans,LoadImage *loader)
+  : image(trans.getDefaultSpace(),8,4096,loader),
+    ram(trans.getDefaultSpace(),8,4096,&image,true),
+    reg(trans.getSpaceByName("register"),8,4096,4096,(MemoryBank *)0),
+    uniq(trans.getUniqueSpace(),8,4096,4096,(MemoryBank *)0),
+    memstate(&trans)
+{
+  memstate.setMemoryBank(&ram);
+  memstate.setMemoryBank(&reg);
+  memstate.setMemoryBank(&uniq);
+}
+
+/// \brief Run an emulator from the given address for up to \b count instructions
+///
+/// \param emu is the emulator
+/// \param entry is the starting address
+/// \param count is the maximum number of instructions to execute
+/// \param secs will hold the elapsed time in seconds
+/// \return the number of instructions executed
+template<typename EMU>
+static int4 runBench(EMU &emu,const Address &entry,int4 count,double &secs)
+
+{
+  int4 executed = 0;
+  clock_t start = clock();
+  try {
+    emu.setExecuteAddress(entry);
+    while(executed < count && !emu.getHalt()) {
+      emu.executeInstruction();
+      executed += 1;
+    }
+  }
+  catch(LowlevelError &err) {
+    cerr << "  stopped after " << dec << executed << " instructions: " << err.explain << endl;
+  }
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return executed;
+}
+
+int main(int argc,char **argv)
+
+{
+  if (argc < 5) {
+    cerr << "usage: emulate_bench <file.sla> <binary> <base> <entry> [count] [name=value ...]" << endl;
+    return 2;
+  }
+  int4 count = (argc > 5) ? atoi(argv[5]) : 10000000;
+
+  RawLoadImage loader(argv[2]);
+  ContextInternal context;
+  Sleigh trans(&loader,&context);
+  DocumentStorage docstorage;
+  try {
+    Element *sleighroot = docstorage.openDocument(argv[1])->getRoot();
+    docstorage.registerTag(sleighroot);
+    trans.initialize(docstorage);
+    loader.attachToSpace(trans.getDefaultSpace());
+    loader.open();
+    loader.adjustVma(strtoull(argv[3],(char **)0,16));
+    for(int4 i=6;i<argc;++i) {
+      string setting(argv[i]);
+      string::size_type pos = setting.find('=');
+      if (pos == string::npos) continue;
+      context.setVariableDefault(setting.substr(0,pos),atoi(setting.c_str()+pos+1));
+    }
+  }
+  catch(XmlError &err) {
+    cerr << "Could not load " << argv[1] << ": " << err.explain << endl;
+    return 1;
+  }
+  catch(LowlevelError &err) {
+    cerr << err.explain << endl;
+    return 1;
+  }
+  Address entry = parseAddress(trans,argv[4]);
+
+  BenchState slowstate(trans,&loader);
+  BreakTableCallBack slowbreak(&trans);
+  EmulatePcodeCache slowemu(&trans,&slowstate.memstate,&slowbreak);
+  double slowsecs;
+  cout << "EmulatePcodeCache:" << endl;
+  int4 slowcount = runBench(slowemu,entry,count,slowsecs);
+  cout << "  " << dec << slowcount << " instructions in " << slowsecs << "s" << endl;
+
+  BenchState faststate(trans,&loader);
+  BreakTableCallBack fastbreak(&trans);
+  double fastsecs;
+  int4 fastcount;
+  {
+    EmulateFast fastemu(&trans,&faststate.memstate,&fastbreak);
+    cout << "EmulateFast:" << endl;
+    fastcount = runBench(fastemu,entry,count,fastsecs);
+  }				// Destroying the emulator writes its flat banks back to the hash banks
+  cout << "  " << dec << fastcount << " instructions in " << fastsecs << "s" << endl;
+  if (fastsecs > 0)
+    cout << "speedup: " << slowsecs / fastsecs << "x" << endl;
+
+  if (slowcount != fastcount) {
+    cout << "MISMATCH: instruction counts differ" << endl;
+    return 1;
+  }
+  map<VarnodeData,string> reglist;
+  trans.getAllRegisters(reglist);
+  int4 diffs = 0;
+  map<VarnodeData,string>::const_iterator iter;
+  for(iter=reglist.begin();iter!=reglist.end();++iter) {
+    const VarnodeData &vn((*iter).first);
+    if (vn.size > sizeof(uintb)) continue;
+    uintb a = slowstate.memstate.getValue(vn.space,vn.offset,vn.size);
+    uintb b = faststate.memstate.getValue(vn.space,vn.offset,vn.size);
+    if (a != b) {
+      cout << "MISMATCH: " << (*iter).second << " = 0x" << hex << a << " vs 0x" << b << endl;
+      diffs += 1;
+    }
+  }
+  if (diffs == 0)
+    cout << "register state matches" << endl;
+  return (diffs == 0) ? 0 : 1;
+}
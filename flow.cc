@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "flow.hh"
+#include "crc32.hh"
 
 /// Prepare for tracing flow for a new function.
 /// The Funcdata object and references to its internal containers must be explicitly given.
@@ -36,6 +37,7 @@ FlowInfo::FlowInfo(Funcdata &d,PcodeOpBank &o,BlockGraph &b,vector<FuncCallSpecs
   inline_recursion = (set<Address> *)0;
   insn_count = 0;
   insn_max = ~((uint4)0);
+  codecrc = 0x12345678;
   flowoverride_present = data.getOverride().hasFlowOverride();
 }
 
@@ -61,6 +63,7 @@ FlowInfo::FlowInfo(Funcdata &d,PcodeOpBank &o,BlockGraph &b,vector<FuncCallSpecs
   unprocessed = op2->unprocessed; // Clone the flow address information
   addrlist = op2->addrlist;
   visited = op2->visited;
+  codecrc = op2->codecrc;
   inline_head = op2->inline_head;
   if (inline_head != (Funcdata *)0) {
     inline_base = op2->inline_base;
@@ -443,6 +446,7 @@ bool FlowInfo::processInstruction(const Address &curaddr,bool &startbasic)
   }
   VisitStat &stat(visited[curaddr]); // Mark that we visited this instruction
   stat.size = step;		// Record size of instruction
+  foldCodeCrc(curaddr,step);
 
   if (curaddr < minaddr)	// Update minimum and maximum address
     minaddr = curaddr;
@@ -1068,6 +1072,7 @@ void FlowInfo::inlineClone(const FlowInfo &inlineflow,const Address &retaddr)
   addrlist.insert(addrlist.end(),inlineflow.addrlist.begin(),
 		  inlineflow.addrlist.end());
   visited.insert(inlineflow.visited.begin(),inlineflow.visited.end());
+  codecrc = crc_update_bytes(codecrc,inlineflow.codecrc,4);
   // We don't copy inline_recursion or inline_head here
 }
 
@@ -1389,3 +1394,25 @@ void FlowInfo::checkMultistageJumptables(void)
       tablelist.push_back(jt->getIndirectOp());
   }  
 }
+
+/// Each instruction is folded in once, when flow first visits it, so the CRC is always
+/// current without re-reading code.  Flow is deterministic, so two flows with the same CRC
+/// have followed the same code, and analysis over the flow (like jump-table recovery)
+/// produces the same result.
+/// \param addr is the address of the instruction
+/// \param size is the number of bytes in the instruction
+void FlowInfo::foldCodeCrc(const Address &addr,int4 size)
+
+{
+  uint1 buf[64];
+  codecrc = crc_update_bytes(codecrc,addr.getOffset(),sizeof(uintb));
+  if (size <= 0 || size > sizeof(buf)) return;
+  try {
+    glb->loader->loadFill(buf,size,addr);
+  }
+  catch(DataUnavailError &err) {
+    return;
+  }
+  for(int4 i=0;i<size;++i)
+    codecrc = crc_update(codecrc,buf[i]);
+}
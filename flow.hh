@@ -87,6 +87,7 @@ private:
   vector<PcodeOp *> tablelist;		///< List of BRANCHIND ops (preparing for jump table recovery)
   vector<PcodeOp *> injectlist;		///< List of p-code ops that need injection
   map<Address,VisitStat> visited;	///< Map of machine instructions that have been visited so far
+  uint4 codecrc;			///< Running CRC over the address and bytes of each visited instruction
   list<PcodeOp *> block_edge1;		///< Source p-code op (Edges between basic blocks)
   list<PcodeOp *> block_edge2;		///< Destination p-code op (Edges between basic blocks)
   uint4 insn_count;			///< Number of instructions flowed through
@@ -120,6 +121,7 @@ private:
   void connectBasic(void);				///< Generate edges between basic blocks
   bool setFallthruBound(Address &bound);		///< Find end of the next unprocessed region
   void handleOutOfBounds(const Address &fromaddr,const Address &toaddr);
+  void foldCodeCrc(const Address &addr,int4 size);	///< Fold a newly visited instruction into the code CRC
   PcodeOp *artificialHalt(const Address &addr,uint4 flag);	///< Create an artificial halt p-code op
   void reinterpreted(const Address &addr);		///< Generate warning message or exception for a \e reinterpreted address
   bool checkForFlowModification(FuncCallSpecs &fspecs);
@@ -162,6 +164,7 @@ public:
   bool hasTooManyInstructions(void) const { return ((flags & toomanyinstructions_present)!=0); }	///< Does \b this flow have too many instructions
   bool isFlowForInline(void) const { return ((flags & flow_forinline)!=0); }	///< Is \b this flow to be in-lined
   bool doesJumpRecord(void) const { return ((flags & record_jumploads)!=0); }	///< Should jump table structure be recorded
+  uint4 getCodeCrc(void) const { return codecrc; }	///< Get the CRC over the instructions visited so far
 };
 
 #endif
@@ -15,6 +15,7 @@
  */
 #include "fspec.hh"
 #include "funcdata.hh"
+#include "crc32.hh"
 
 void ParamEntry::resolveJoin(void)
 
@@ -2951,6 +2952,43 @@ void FuncProto::copy(const FuncProto &op2)
   injectid = op2.injectid;
 }
 
+/// Parameters and the return value are copied into a new ProtoStoreInternal, so the copy
+/// does not share symbols with the Scope backing the other prototype and remains valid
+/// after that Scope is cleared.
+/// \param op2 is the other prototype to copy
+void FuncProto::copyDetached(const FuncProto &op2)
+
+{
+  model = op2.model;
+  extrapop = op2.extrapop;
+  flags = op2.flags;
+  effectlist = op2.effectlist;
+  likelytrash = op2.likelytrash;
+  injectid = op2.injectid;
+  if (store != (ProtoStore *)0)
+    delete store;
+  store = new ProtoStoreInternal(getArch()->types->getTypeVoid());
+  ParameterPieces pieces;
+  int4 num = op2.numParams();
+  for(int4 i=0;i<num;++i) {
+    ProtoParameter *param = op2.getParam(i);
+    pieces.addr = param->getAddress();
+    pieces.type = param->getType();
+    pieces.flags = 0;
+    if (param->isTypeLocked()) pieces.flags |= Varnode::typelock;
+    if (param->isNameLocked()) pieces.flags |= Varnode::namelock;
+    if (param->isIndirectStorage()) pieces.flags |= Varnode::indirectstorage;
+    if (param->isHiddenReturn()) pieces.flags |= Varnode::hiddenretparm;
+    store->setInput(i,param->getName(),pieces);
+  }
+  ProtoParameter *outparam = op2.getOutput();
+  pieces.addr = outparam->getAddress();
+  pieces.type = outparam->getType();
+  pieces.flags = 0;
+  if (outparam->isTypeLocked()) pieces.flags |= Varnode::typelock;
+  store->setOutput(pieces);
+}
+
 void FuncProto::copyFlowEffects(const FuncProto &op2)
 
 {
@@ -4941,3 +4979,116 @@ void FuncCallSpecs::countMatchingCalls(const vector<FuncCallSpecs *> &qlst)
   for(;lastChange<i;++lastChange)
     copyList[lastChange]->matchCallCount = num;
 }
+
+/// The CRC covers the bytes of each range in turn, prefixed by the range's starting offset,
+/// so that code moved to a different address is not mistaken for the original.
+/// \param loader is the load image providing the bytes
+/// \param body is the set of address ranges to cover
+/// \return the CRC value
+uint4 ProtoCache::calcBodyCrc(LoadImage *loader,const RangeList &body)
+
+{
+  uint4 reg = 0x12345678;
+  uint1 buf[256];
+  set<Range>::const_iterator iter;
+  for(iter=body.begin();iter!=body.end();++iter) {
+    uintb off = (*iter).getFirst();
+    for(int4 i=0;i<sizeof(uintb);++i) {
+      reg = crc_update(reg,(uint4)(off & 0xff));
+      off >>= 8;
+    }
+    Address addr = (*iter).getFirstAddr();
+    uintb remain = (*iter).getLast() - (*iter).getFirst() + 1;
+    while(remain > 0) {
+      int4 size = (remain > sizeof(buf)) ? sizeof(buf) : (int4)remain;
+      loader->loadFill(buf,size,addr);	// Unavailable bytes throw, the caller treats this as a miss
+      for(int4 i=0;i<size;++i)
+	reg = crc_update(reg,buf[i]);
+      addr = addr + size;
+      remain -= size;
+    }
+  }
+  return reg;
+}
+
+/// The entry is returned only if the bytes of the function body are unchanged
+/// since the prototype was recovered.  The bytes are only re-read the first time the
+/// entry is requested in the current pass.
+/// \param fd is the function whose prototype is requested
+/// \return the cached, locked prototype or NULL if there is no valid entry
+const FuncProto *ProtoCache::find(const Funcdata &fd) const
+
+{
+  map<Address,Entry>::const_iterator iter = cache.find(fd.getAddress());
+  if (iter == cache.end()) return (const FuncProto *)0;
+  const Entry &entry( (*iter).second );
+  if (entry.checked == pass)
+    return entry.proto;
+  try {
+    if (calcBodyCrc(fd.getArch()->loader,entry.body) != entry.crc)
+      return (const FuncProto *)0;
+  }
+  catch(DataUnavailError &err) {
+    return (const FuncProto *)0;
+  }
+  entry.checked = pass;
+  return entry.proto;
+}
+
+/// The function must have just been analyzed, so that its basic blocks (which determine
+/// the body covered by the CRC) and its recovered prototype are both available.
+/// Functions whose prototype is already locked gain nothing from the cache and are skipped.
+/// \param fd is the analyzed function
+void ProtoCache::store(const Funcdata &fd)
+
+{
+  const FuncProto &fp( fd.getFuncProto() );
+  if (fp.isInputLocked() && fp.isOutputLocked()) return;
+  if (fp.hasInputErrors() || fp.hasOutputErrors()) return;
+  const BlockGraph &graph( fd.getBasicBlocks() );
+  RangeList body;
+  for(int4 i=0;i<graph.getSize();++i) {
+    const FlowBlock *bl = graph.getBlock(i);
+    Address start = bl->getStart();
+    Address stop = bl->getStop();
+    if (start.isInvalid() || stop.isInvalid()) continue;
+    body.insertRange(start.getSpace(),start.getOffset(),stop.getOffset());
+  }
+  if (body.numRanges() == 0) return;
+  uint4 crc;
+  try {
+    crc = calcBodyCrc(fd.getArch()->loader,body);
+  }
+  catch(DataUnavailError &err) {
+    return;
+  }
+  Entry &entry( cache[fd.getAddress()] );
+  if (entry.proto != (FuncProto *)0)
+    delete entry.proto;
+  entry.body = body;
+  entry.crc = crc;
+  entry.checked = pass;
+  entry.proto = new FuncProto();
+  entry.proto->copyDetached(fp);
+  entry.proto->setInputLock(true);
+  entry.proto->setOutputLock(true);
+}
+
+/// \param addr is the entry point of the function to drop
+void ProtoCache::erase(const Address &addr)
+
+{
+  map<Address,Entry>::iterator iter = cache.find(addr);
+  if (iter == cache.end()) return;
+  delete (*iter).second.proto;
+  cache.erase(iter);
+}
+
+void ProtoCache::clear(void)
+
+{
+  map<Address,Entry>::iterator iter;
+  for(iter=cache.begin();iter!=cache.end();++iter)
+    delete (*iter).second.proto;
+  cache.clear();
+}
@@ -1179,6 +1179,7 @@ public:
   Architecture *getArch(void) const { return model->getArch(); }	///< Get the Architecture owning \b this
   void copy(const FuncProto &op2);					///< Copy another function prototype
   void copyFlowEffects(const FuncProto &op2);	 			///< Copy properties that affect data-flow
+  void copyDetached(const FuncProto &op2);				///< Copy another prototype into internal storage
   void getPieces(PrototypePieces &pieces) const;			///< Get the raw pieces of the prototype
   void setPieces(const PrototypePieces &pieces);			///< Set \b this prototype based on raw pieces
   void setScope(Scope *s,const Address &startpoint);			///< Set a backing symbol Scope for \b this
@@ -1516,6 +1517,38 @@ public:
   static void countMatchingCalls(const vector<FuncCallSpecs *> &qlst);
 };
 
+class LoadImage;
+
+/// \brief Prototypes recovered for individual functions, reused across decompiles
+///
+/// When a function has been analyzed (by the full \e decompile root or the cheaper
+/// \e paramid root), the parameters and return value recovered for it are stored here
+/// as a locked copy. Callers consult the cache instead of running speculative trial
+/// analysis at each call site. An entry is only valid while the bytes of the function
+/// body are unchanged, as determined by a CRC over the address ranges of its basic blocks.
+/// The CRC is checked at most once per \e pass (see newPass()), not at every call site.
+class ProtoCache {
+  /// \brief A single cached prototype
+  struct Entry {
+    RangeList body;		///< Address ranges covered by the function's basic blocks
+    uint4 crc;			///< CRC of the bytes in \b body when the prototype was recovered
+    mutable uint4 checked;	///< Pass in which \b crc was last verified
+    FuncProto *proto;		///< Locked copy of the recovered prototype
+    Entry(void) { crc = 0; checked = 0; proto = (FuncProto *)0; }	///< Constructor
+  };
+  map<Address,Entry> cache;	///< Entries indexed by function entry point
+  uint4 pass;			///< Current pass, entries verified in this pass are trusted
+  static uint4 calcBodyCrc(LoadImage *loader,const RangeList &body);
+public:
+  ProtoCache(void) { pass = 1; }	///< Constructor
+  ~ProtoCache(void) { clear(); }	///< Destructor
+  void newPass(void) { pass += 1; }	///< Require every entry to be verified again before use
+  const FuncProto *find(const Funcdata &fd) const;	///< Get the cached prototype for a function, if still valid
+  void store(const Funcdata &fd);			///< Cache the prototype recovered for an analyzed function
+  void erase(const Address &addr);			///< Drop the entry for a single function
+  void clear(void);					///< Drop all entries
+};
+
 /// Return the trial associated with the input Varnode to the associated p-code CALL or CALLIND.
 /// We take into account the call address parameter (subtract 1) and if the index occurs \e after the
 /// index holding the stackpointer placeholder, we subtract an additional 1.
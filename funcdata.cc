@@ -65,7 +65,7 @@ void Funcdata::clear(void)
 
 {				// Clear everything associated with decompilation (analysis)
 
-  flags &= ~(highlevel_on|blocks_generated|processing_started|typerecovery_on|restart_pending);
+  flags &= ~(highlevel_on|blocks_generated|processing_started|processing_complete|typerecovery_on|restart_pending);
   clean_up_index = 0;
   high_level_index = 0;
   cast_phase_index = 0;
@@ -169,6 +169,7 @@ Funcdata::~Funcdata(void)
   clearCallSpecs();
   for(int4 i=0;i<jumpvec.size();++i) // Delete jumptables
     delete jumpvec[i];
+  glb->analysislru->forget(this);
   glb = (Architecture *)0;
 }
 
@@ -845,7 +846,7 @@ void Funcdata::doLiveInject(InjectPayload *payload,const Address &addr,BlockBasi
   }
 }
 
-void PcodeEmitFd::dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
+void PcodeEmitFd::buildOp(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
 
 {				// Convert template data into a real PcodeOp
   PcodeOp *op;
@@ -877,6 +878,19 @@ void PcodeEmitFd::dump(const Address &addr,OpCode opc,VarnodeData *outvar,Varnod
   }
 }
 
+void PcodeEmitFd::dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
+
+{
+  buildOp(addr,opc,outvar,vars,isize);
+}
+
+void PcodeEmitFd::dumpBlock(const Address &addr,const PcodeData *ops,int4 numops)
+
+{				// Build the whole instruction without a virtual call per op
+  for(int4 i=0;i<numops;++i)
+    buildOp(addr,ops[i].opc,ops[i].outvar,ops[i].invar,ops[i].isize);
+}
+
 #ifdef OPACTION_DEBUG
 
 /// The current state of the op is recorded for later comparison after
@@ -992,3 +1006,71 @@ void Funcdata::debugPrintRange(int4 i) const
 
 #endif
 
+/// The estimate counts the PcodeOps and Varnodes, with an allowance for the structures
+/// that scale with them (tree nodes, input lists, HighVariables, covers, and blocks).
+/// \param fd is the function
+/// \return the estimated number of bytes
+uintb AnalysisLru::footprint(const Funcdata *fd)
+
+{
+  uintb res = (uintb)fd->numOps() * (sizeof(PcodeOp) + 96);
+  res += (uintb)fd->numVarnodes() * (sizeof(Varnode) + 128);
+  return res;
+}
+
+/// The function is moved to the front of the list. Then, starting from the least recently
+/// used function, analysis is cleared until the total estimated footprint is under the
+/// ceiling. Functions whose analysis has already been cleared are dropped from the list, and
+/// functions still being analyzed (as when \b fd is being in-lined into a caller) are skipped.
+/// Drivers must clear the analysis of a function whose actions threw or stopped early, or it
+/// is treated as still being analyzed and is never evicted.
+/// \param fd is the function about to be analyzed
+void AnalysisLru::touch(Funcdata *fd)
+
+{
+  map<Funcdata *,list<Funcdata *>::iterator>::iterator iter = where.find(fd);
+  if (iter != where.end())
+    order.splice(order.begin(),order,(*iter).second);
+  else {
+    order.push_front(fd);
+    where[fd] = order.begin();
+  }
+  uintb total = 0;
+  list<Funcdata *>::iterator liter = order.begin();
+  ++liter;			// Never evict the function being analyzed
+  while(liter != order.end()) {
+    uintb sz = footprint(*liter);
+    if (sz == 0) {		// Nothing left to free
+      where.erase(*liter);
+      liter = order.erase(liter);
+      continue;
+    }
+    total += sz;
+    ++liter;
+  }
+  if (ceiling == 0) return;
+  liter = order.end();
+  --liter;
+  while(total > ceiling && liter != order.begin()) {
+    Funcdata *victim = *liter;
+    if (victim->isProcStarted() && !victim->isProcComplete()) {
+      --liter;			// Analysis in progress (a caller in-lining fd), leave it alone
+      continue;
+    }
+    total -= footprint(victim);
+    where.erase(victim);
+    liter = order.erase(liter);
+    --liter;
+    victim->clear();
+  }
+}
+
+/// \param fd is the function being destroyed
+void AnalysisLru::forget(Funcdata *fd)
+
+{
+  map<Funcdata *,list<Funcdata *>::iterator>::iterator iter = where.find(fd);
+  if (iter == where.end()) return;
+  order.erase((*iter).second);
+  where.erase(iter);
+}
@@ -388,6 +388,7 @@ public:
   Merge &getMerge(void) { return covermerge; }			///< Get the Merge object for \b this function
 
   // op routines
+  int4 numOps(void) const { return obank.numOps(); }		///< Get the total number of PcodeOps
   PcodeOp *newOp(int4 inputs,const Address &pc);		/// Allocate a new PcodeOp with Address
   PcodeOp *newOp(int4 inputs,const SeqNum &sq);			/// Allocate a new PcodeOp with sequence number
   PcodeOp *newOpBefore(PcodeOp *follow,OpCode opc,Varnode *in1,Varnode *in2,Varnode *in3=(Varnode *)0);
@@ -539,13 +540,36 @@ public:
 #endif
 };
 
+/// \brief Least-recently-used tracking of functions holding analysis state
+///
+/// After decompilation, a Funcdata keeps its PcodeOps, Varnodes, basic blocks, and local
+/// symbols until it is analyzed again. Each time a function is about to be analyzed it is
+/// moved to the front of \b this list, and the analysis of the least recently used
+/// functions is cleared until the estimated footprint of the rest fits under the ceiling.
+/// Clearing keeps the light-weight parts of the function: its symbol, its prototype, and
+/// any locked local symbols. The function being analyzed is never evicted.
+class AnalysisLru {
+  list<Funcdata *> order;	///< Functions with (possibly) live analysis, most recent first
+  map<Funcdata *,list<Funcdata *>::iterator> where;	///< Position of each function in \b order
+  uintb ceiling;		///< Maximum estimated bytes of analysis to keep (0 for no limit)
+  static uintb footprint(const Funcdata *fd);	///< Estimate the memory held by a function's analysis
+public:
+  AnalysisLru(void) { ceiling = 0; }		///< Constructor
+  void setCeiling(uintb bytes) { ceiling = bytes; }	///< Set the maximum estimated bytes of analysis to keep
+  uintb getCeiling(void) const { return ceiling; }	///< Get the maximum estimated bytes of analysis to keep
+  void touch(Funcdata *fd);			///< Mark a function as about to be analyzed, evicting idle ones
+  void forget(Funcdata *fd);			///< Stop tracking a function that is being destroyed
+};
+
 /// \brief A p-code emitter for building PcodeOp objects
 ///
 /// The emitter is attached to a specific Funcdata object.  Any p-code generated (by FlowInfo typically)
 /// will be instantiated as PcodeOp and Varnode objects and placed in the Funcdata \e dead list.
 class PcodeEmitFd : public PcodeEmit {
   Funcdata *fd;			///< The Funcdata container to emit to
+  void buildOp(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize);
   virtual void dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize);
+  virtual void dumpBlock(const Address &addr,const PcodeData *ops,int4 numops);
 public:
   void setFuncdata(Funcdata *f) { fd = f; }	///< Establish the container for \b this emitter
 };
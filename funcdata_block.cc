@@ -512,7 +512,8 @@ int4 Funcdata::stageJumpTable(JumpTable *jt,PcodeOp *op,FlowInfo *flow)
     glb->allacts.setCurrent(oldactname); // Restore old action
     if (partop->isDead())	// Indirectop we were trying to recover was eliminated as dead code (unreachable)
       return 0;			// Return jumptable as 
-    jt->setLoadCollect(flow->doesJumpRecord());
+    if (flow->doesJumpRecord())
+      jt->setLoadCollect(true);
     jt->setIndirectOp(partop);
     if (jt->getStage()>0)
       jt->recoverMultistage(&partial);
@@ -541,7 +542,9 @@ int4 Funcdata::stageJumpTable(JumpTable *jt,PcodeOp *op,FlowInfo *flow)
 /// copy of the current state of data-flow is made, simplification transformations are applied
 /// to the copy, and the resulting data-flow tree is examined to enumerate possible values
 /// of the input Varnode to the given BRANCHIND PcodeOp.  This information is stored in a
-/// JumpTable object.
+/// JumpTable object.  If the Architecture's JumpTableCache is enabled, tables recovered from the
+/// same code (as determined by a CRC over the instructions flowed so far and over the table bytes)
+/// are reused from it.  Load points are only collected for tables that may go in the cache.
 /// \param op is the given BRANCHIND PcodeOp
 /// \param flow is current flow information for \b this function
 /// \param failuremode will hold the final success/failure code (0=success)
@@ -567,13 +570,29 @@ JumpTable *Funcdata::recoverJumpTable(PcodeOp *op,FlowInfo *flow,int4 &failuremo
 
   if ((flags & jumptablerecovery_dont)!=0)
     return (JumpTable *)0;	// Explicitly told not to recover jumptables
+  bool usecache = glb->jumpcache->isEnabled() && !flow->doesJumpRecord();
+  uint4 crc = 0;
+  if (usecache) {
+    crc = flow->getCodeCrc();
+    const JumpTable *cached = glb->jumpcache->find(baseaddr,op->getAddr(),crc);
+    if (cached != (const JumpTable *)0) {
+      jt = new JumpTable(cached); // Same code as a previous recovery, reuse its table
+      jumpvec.push_back(jt);
+      jt->setIndirectOp(op);
+      return jt;
+    }
+  }
   JumpTable trialjt(glb);
+  if (usecache)
+    trialjt.setLoadCollect(true);	// Table bytes are checked when the cached table is reused
   failuremode = stageJumpTable(&trialjt,op,flow);
   if (failuremode != 0)
     return (JumpTable *)0;
   //  if (trialjt.is_twostage())
   //    warning("Jumptable maybe incomplete. Second-stage recovery not implemented",trialjt.Opaddress());
   jt = new JumpTable(&trialjt); // Make the jumptable permanent
+  if (usecache && jt->isRecovered() && !jt->isPossibleMultistage() && jt->getStage() == 0)
+    glb->jumpcache->store(baseaddr,jt,crc);
   jumpvec.push_back(jt);
   jt->setIndirectOp(op);		// Relink table back to original op
   return jt;
@@ -1943,43 +1943,57 @@ void Heritage::buildADT(void)
 
 /// \brief The heart of the phi-node placement algorithm
 ///
-/// Recursively walk the dominance tree starting from a given block.
+/// Walk the dominance tree starting from a given block.
 /// Calculate any children that are in the dominance frontier and add
-/// them to the \b merge array.
+/// them to the \b merge array.  The walk is depth-first in the same order as a
+/// recursive visit, but uses an explicit stack, so the depth of the tree is not
+/// limited by the thread's stack size.
 /// \param qnode is the parent of the given block
 /// \param vnode is the given block
 void Heritage::visitIncr(FlowBlock *qnode,FlowBlock *vnode)
 
 {
   int4 i,j,k;
-  FlowBlock *v,*child;
+  FlowBlock *v;
   vector<FlowBlock *>::iterator iter,enditer;
+  vector<pair<FlowBlock *,int4> > path;	// Current path in the dominance tree, with next child to visit
   
-  i = vnode->getIndex();
   j = qnode->getIndex();
-  iter = augment[i].begin();
-  enditer = augment[i].end();
-  for(;iter!=enditer;++iter) {
-    v = *iter;
-    if (v->getImmedDom()->getIndex() < j) { // If idom(v) is strict ancestor of qnode
-      k = v->getIndex();
-      if ((flags[k]&merged_node)==0) {
-	merge.push_back(v);
-	flags[k] |= merged_node;
-      }
-      if ((flags[k]&mark_node)==0) { // If v is not marked
-	flags[k] |= mark_node;	// then mark it
-	pq.insert(v,depth[k]); // insert it into the queue
+  while(vnode != (FlowBlock *)0) {
+    i = vnode->getIndex();
+    iter = augment[i].begin();
+    enditer = augment[i].end();
+    for(;iter!=enditer;++iter) {
+      v = *iter;
+      if (v->getImmedDom()->getIndex() < j) { // If idom(v) is strict ancestor of qnode
+	k = v->getIndex();
+	if ((flags[k]&merged_node)==0) {
+	  merge.push_back(v);
+	  flags[k] |= merged_node;
+	}
+	if ((flags[k]&mark_node)==0) { // If v is not marked
+	  flags[k] |= mark_node;	// then mark it
+	  pq.insert(v,depth[k]); // insert it into the queue
+	}
       }
+      else
+	break;
     }
-    else
-      break;
-  }
-  if ((flags[i]&boundary_node)==0) { // If vnode is not a boundary node
-    for(j=0;j<domchild[i].size();++j) {
-      child = domchild[i][j];
-      if ((flags[child->getIndex()]&mark_node)==0)	// If the child is not marked
-	visitIncr(qnode,child);
+    if ((flags[i]&boundary_node)==0) // If vnode is not a boundary node, visit its children
+      path.push_back(pair<FlowBlock *,int4>(vnode,0));
+    vnode = (FlowBlock *)0;
+    while(!path.empty()) {	// Find the next unmarked child along the path
+      const vector<FlowBlock *> &children( domchild[path.back().first->getIndex()] );
+      int4 slot = path.back().second;
+      if (slot < children.size()) {
+	path.back().second += 1;
+	if ((flags[children[slot]->getIndex()]&mark_node)==0) { // If the child is not marked
+	  vnode = children[slot];
+	  break;
+	}
+	continue;
+      }
+      path.pop_back();
     }
   }
 }
@@ -2024,25 +2038,27 @@ void Heritage::calcMultiequals(const vector<Varnode *> &write)
 
 /// \brief The heart of the renaming algorithm.
 ///
-/// From the given block, recursively walk the dominance tree. At each
-/// block, visit the PcodeOps in execution order looking for Varnodes that
+/// Visit the PcodeOps of the given block in execution order looking for Varnodes that
 /// need to be renamed.  As write Varnodes are encountered, a set of stack
 /// containers, differentiated by the Varnode's address, are updated so the
 /// so the current \e active Varnode is always ready for any \e free Varnode that
 /// is encountered. In this was all \e free Varnodes are replaced with the
 /// appropriate write Varnode or are promoted to a formal \e input Varnode.
+/// Every push onto a stack is recorded in \b writelist, so rename() can pop
+/// them when the dominance tree walk leaves the block.
 /// \param bl is the current basic block in the dominance tree walk
 /// \param varstack is the system of stacks, organized by address
-void Heritage::renameRecurse(BlockBasic *bl,VariableStack &varstack)
+/// \param writelist records the stack of each write Varnode pushed
+void Heritage::renameBlock(BlockBasic *bl,VariableStack &varstack,vector<vector<Varnode *> *> &writelist)
 
 {
-  vector<Varnode *> writelist;	// List varnodes that are written in this block
   BlockBasic *subbl;
   list<PcodeOp *>::iterator oiter,suboiter;
   PcodeOp *op,*multiop;
   Varnode *vnout,*vnin,*vnnew;
   int4 i,slot;
 
+  if ((flags[bl->getIndex()] & rename_node)==0) return;	// Nothing to rename in this block
   for(oiter=bl->beginOp();oiter!=bl->endOp();++oiter) {
     op = *oiter;
     if (op->code() != CPUI_MULTIEQUAL) {
@@ -2082,8 +2098,9 @@ void Heritage::renameRecurse(BlockBasic *bl,VariableStack &varstack)
     if (vnout == (Varnode *)0) continue;
     if (!vnout->isActiveHeritage()) continue; // Not a normalized write
     vnout->clearActiveHeritage();
-    varstack[ vnout->getAddr() ].push_back(vnout); // Push write onto stack
-    writelist.push_back(vnout);
+    vector<Varnode *> &stack( varstack[ vnout->getAddr() ] );
+    stack.push_back(vnout);	// Push write onto stack
+    writelist.push_back(&stack);
   }
   for(i=0;i<bl->sizeOut();++i) {
     subbl = (BlockBasic *)bl->getOut(i);
@@ -2106,15 +2123,6 @@ void Heritage::renameRecurse(BlockBasic *bl,VariableStack &varstack)
 	  fd->deleteVarnode(vnin);
       }
     }
-  }
-				// Now we recurse to subtrees
-  i = bl->getIndex();
-  for(slot=0;slot<domchild[i].size();++slot)
-    renameRecurse((BlockBasic *)domchild[i][slot],varstack);
-				// Now we pop this blocks writes of the stack
-  for(i=0;i<writelist.size();++i) {
-    vnout = writelist[i];
-    varstack[vnout->getAddr()].pop_back();
   }
 }
 
@@ -2139,14 +2147,114 @@ void Heritage::bumpDeadcodeDelay(Varnode *vn)
   fd->setRestartPending(true);
 }
 
+/// \brief Mark a block as needing a visit from the renaming algorithm
+///
+/// The block is marked as a \e rename_node, and it and all its dominators are marked
+/// as being on a \e rename_path.
+/// \param bl is the given block
+void Heritage::markRenameBlock(FlowBlock *bl)
+
+{
+  flags[bl->getIndex()] |= rename_node;
+  while(bl != (FlowBlock *)0) {
+    int4 i = bl->getIndex();
+    if ((flags[i] & rename_path)!=0) break;	// Dominators have already been marked
+    flags[i] |= rename_path;
+    bl = bl->getImmedDom();
+  }
+}
+
+/// \brief Mark the blocks that the renaming algorithm needs to visit in the current pass
+///
+/// Only Varnodes in the \b disjoint ranges can be renamed, so the blocks that write or read
+/// these are collected. For a free read in a MULTIEQUAL, it is the corresponding
+/// input block that fills in the read. Later passes only cover newly discovered ranges,
+/// so the renaming walk skips the parts of the dominator tree that don't touch them.
+void Heritage::markRenameBlocks(void)
+
+{
+  LocationMap::iterator iter;
+  list<PcodeOp *>::const_iterator diter;
+
+  for(iter=disjoint.begin();iter!=disjoint.end();++iter) {
+    Address addr = (*iter).first;
+    int4 size = (*iter).second.size;
+    VarnodeLocSet::const_iterator viter = fd->beginLoc(addr);
+    VarnodeLocSet::const_iterator enditer;
+    uintb start = addr.getOffset();
+    addr = addr + size;
+    if (addr.getOffset() < start) {	// Wraparound
+      Address tmp(addr.getSpace(),addr.getSpace()->getHighest());
+      enditer = fd->endLoc(tmp);
+    }
+    else
+      enditer = fd->beginLoc(addr);
+    while(viter != enditer) {
+      Varnode *vn = *viter;
+      ++viter;
+      if (vn->isWritten()) {
+	if (vn->isActiveHeritage())
+	  markRenameBlock(vn->getDef()->getParent());
+	continue;
+      }
+      if (vn->isHeritageKnown()) continue;
+      for(diter=vn->beginDescend();diter!=vn->endDescend();++diter) {
+	PcodeOp *op = *diter;
+	if (op->code() == CPUI_MULTIEQUAL) {
+	  for(int4 slot=0;slot<op->numInput();++slot)
+	    if (op->getIn(slot) == vn)
+	      markRenameBlock(op->getParent()->getIn(slot));
+	}
+	else
+	  markRenameBlock(op->getParent());
+      }
+    }
+  }
+}
+
 /// \brief Perform the renaming algorithm for the current set of address ranges
 ///
-/// Phi-node placement must already have happened.
+/// Phi-node placement must already have happened.  Only the blocks marked by
+/// markRenameBlocks() and their dominators are visited.  The dominance tree is walked
+/// depth-first with an explicit stack, so the depth of the tree is not limited by the
+/// thread's stack size.
 void Heritage::rename(void)
 
 {
   VariableStack varstack;
-  renameRecurse((BlockBasic *)fd->getBasicBlocks().getBlock(0),varstack);
+  vector<vector<Varnode *> *> writelist;	// Stack of every write pushed, in order
+  vector<pair<BlockBasic *,int4> > path;	// Current path in the dominance tree, with next child to visit
+  vector<int4> writemark;			// Size of writelist on entry to each block in path
+
+  markRenameBlocks();
+  BlockBasic *rootbl = (BlockBasic *)fd->getBasicBlocks().getBlock(0);
+  flags[rootbl->getIndex()] |= rename_path;
+  writemark.push_back(0);
+  renameBlock(rootbl,varstack,writelist);
+  path.push_back(pair<BlockBasic *,int4>(rootbl,0));
+  while(!path.empty()) {
+    BlockBasic *bl = path.back().first;
+    int4 slot = path.back().second;
+    const vector<FlowBlock *> &children( domchild[bl->getIndex()] );
+    if (slot < children.size()) {
+      path.back().second += 1;
+      BlockBasic *subbl = (BlockBasic *)children[slot];
+      if ((flags[subbl->getIndex()] & rename_path)==0) continue;	// Nothing to rename in subtree
+      writemark.push_back(writelist.size());
+      renameBlock(subbl,varstack,writelist);
+      path.push_back(pair<BlockBasic *,int4>(subbl,0));
+      continue;
+    }
+    int4 mark = writemark.back();	// Pop this block's writes off the stacks
+    while(writelist.size() > mark) {
+      writelist.back()->pop_back();
+      writelist.pop_back();
+    }
+    writemark.pop_back();
+    path.pop_back();
+  }
+  for(int4 i=0;i<flags.size();++i)
+    flags[i] &= ~(rename_node|rename_path);
   disjoint.clear();
 }
 
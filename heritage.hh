@@ -172,7 +172,9 @@ class Heritage {
   enum heritage_flags {
     boundary_node = 1,		///< Augmented Dominator Tree boundary node
     mark_node = 2,		///< Node has already been in queue
-    merged_node = 4		///< Node has already been merged
+    merged_node = 4,		///< Node has already been merged
+    rename_node = 8,		///< Node contains Varnodes being renamed in the current pass
+    rename_path = 16		///< Node dominates a \e rename_node
   };
 
   /// \brief Node for depth-first traversal of stack references
@@ -260,7 +262,9 @@ class Heritage {
   bool refinement(const Address &addr,int4 size,const vector<Varnode *> &readvars,const vector<Varnode *> &writevars,const vector<Varnode *> &inputvars);
   void visitIncr(FlowBlock *qnode,FlowBlock *vnode);
   void calcMultiequals(const vector<Varnode *> &write);
-  void renameRecurse(BlockBasic *bl,VariableStack &varstack);
+  void markRenameBlock(FlowBlock *bl);
+  void markRenameBlocks(void);
+  void renameBlock(BlockBasic *bl,VariableStack &varstack,vector<vector<Varnode *> *> &writelist);
   void bumpDeadcodeDelay(Varnode *vn);
   void placeMultiequals(void);
   void rename(void);
@@ -0,0 +1,297 @@
+/* ###
+ * IP: GHIDRA
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Standalone stress test of SSA construction on a very deep dominator tree.
+//
+//   heritage_stress [links] [stackkb]
+//
+// A synthetic processor generates a function whose dominator tree is a chain of <links>
+// blocks (100000 by default).  Each link is a conditional branch around a block that
+// increments register r1, so every link needs a MULTIEQUAL.  Flow following and a full
+// heritage pass are run on a thread with a <stackkb> KB stack (256 by default), far too
+// small for a recursive walk of the tree.  The MULTIEQUALs and the final read of r1 are
+// then checked.
+
+#include "funcdata.hh"
+#include "inject_sleigh.hh"
+#include <pthread.h>
+#include <iostream>
+
+/// \brief Translator for a synthetic processor that encodes a chain of diamonds
+///
+/// Every instruction is 1 byte long and is defined by its address alone:
+///   - 0:         r1 = COPY #0
+///   - 1 + 2*k:   CBRANCH (2*k + 3), r2	(link \e k)
+///   - 2 + 2*k:   r1 = INT_ADD r1, #1
+///   - 1 + 2*n:   r0 = INT_ADD r1, r3 ; BRANCH (1 + 2*n)
+class StressTranslate : public Translate {
+  int4 links;				///< Number of links in the chain
+  map<string,VarnodeData> registers;	///< Registers by name
+public:
+  StressTranslate(int4 n) { links = n; }	///< Constructor
+  virtual void initialize(DocumentStorage &store);
+  virtual void addRegister(const string &nm,AddrSpace *base,uintb offset,int4 size);
+  virtual const VarnodeData &getRegister(const string &nm) const;
+  virtual string getRegisterName(AddrSpace *base,uintb off,int4 size) const;
+  virtual void getAllRegisters(map<VarnodeData,string> &reglist) const;
+  virtual void getUserOpNames(vector<string> &res) const {}
+  virtual int4 instructionLength(const Address &baseaddr) const { return 1; }
+  virtual int4 oneInstruction(PcodeEmit &emit,const Address &baseaddr) const;
+  virtual int4 printAssembly(AssemblyEmit &emit,const Address &baseaddr) const;
+};
+
+void StressTranslate::initialize(DocumentStorage &store)
+
+{
+  insertSpace(new ConstantSpace(this,this,"const",AddrSpace::constant_space_index));
+  insertSpace(new OtherSpace(this,this,"OTHER",AddrSpace::other_space_index));
+  insertSpace(new UniqueSpace(this,this,"unique",2,0));
+  insertSpace(new AddrSpace(this,this,IPTR_PROCESSOR,"ram",4,1,3,AddrSpace::hasphysical,1));
+  insertSpace(new AddrSpace(this,this,IPTR_PROCESSOR,"register",4,1,4,0,0));
+  setDefaultSpace(3);
+  setUniqueBase(0x1000);
+  AddrSpace *regspace = getSpaceByName("register");
+  addRegister("r0",regspace,0,4);
+  addRegister("r1",regspace,4,4);
+  addRegister("r2",regspace,8,4);
+  addRegister("r3",regspace,12,4);
+  addRegister("sp",regspace,16,4);
+}
+
+void StressTranslate::addRegister(const string &nm,AddrSpace *base,uintb offset,int4 size)
+
+{
+  VarnodeData &vn( registers[nm] );
+  vn.space = base;
+  vn.offset = offset;
+  vn.size = size;
+}
+
+const VarnodeData &StressTranslate::getRegister(const string &nm) const
+
+{
+  map<string,VarnodeData>::const_iterator iter = registers.find(nm);
+  if (iter == registers.end())
+    throw LowlevelError("No register named "+nm);
+  return (*iter).second;
+}
+
+string StressTranslate::getRegisterName(AddrSpace *base,uintb off,int4 size) const
+
+{
+  map<string,VarnodeData>::const_iterator iter;
+  for(iter=registers.begin();iter!=registers.end();++iter) {
+    const VarnodeData &vn( (*iter).second );
+    if (vn.space == base && vn.offset == off && vn.size == (uint4)size)
+      return (*iter).first;
+  }
+  return "";
+}
+
+void StressTranslate::getAllRegisters(map<VarnodeData,string> &reglist) const
+
+{
+  map<string,VarnodeData>::const_iterator iter;
+  for(iter=registers.begin();iter!=registers.end();++iter)
+    reglist[(*iter).second] = (*iter).first;
+}
+
+int4 StressTranslate::oneInstruction(PcodeEmit &emit,const Address &baseaddr) const
+
+{
+  uintb off = baseaddr.getOffset();
+  uintb endoff = 1 + 2*(uintb)links;
+  VarnodeData out,in[2];
+  if (off == 0) {
+    out = getRegister("r1");
+    in[0].space = getConstantSpace(); in[0].offset = 0; in[0].size = 4;
+    emit.dump(baseaddr,CPUI_COPY,&out,in,1);
+  }
+  else if (off < endoff && (off & 1) != 0) {
+    in[0].space = getDefaultSpace(); in[0].offset = off + 2; in[0].size = 1;
+    in[1] = getRegister("r2");
+    in[1].size = 1;
+    emit.dump(baseaddr,CPUI_CBRANCH,(VarnodeData *)0,in,2);
+  }
+  else if (off < endoff) {
+    out = getRegister("r1");
+    in[0] = out;
+    in[1].space = getConstantSpace(); in[1].offset = 1; in[1].size = 4;
+    emit.dump(baseaddr,CPUI_INT_ADD,&out,in,2);
+  }
+  else if (off == endoff) {
+    out = getRegister("r0");
+    in[0] = getRegister("r1");
+    in[1] = getRegister("r3");
+    emit.dump(baseaddr,CPUI_INT_ADD,&out,in,2);
+    in[0].space = getDefaultSpace(); in[0].offset = off; in[0].size = 1;
+    emit.dump(baseaddr,CPUI_BRANCH,(VarnodeData *)0,in,1);
+  }
+  else
+    throw BadDataError("Flow past the end of the chain");
+  return 1;
+}
+
+int4 StressTranslate::printAssembly(AssemblyEmit &emit,const Address &baseaddr) const
+
+{
+  emit.dump(baseaddr,"stress","");
+  return 1;
+}
+
+/// \brief A load image with no bytes, the synthetic translator doesn't read any
+class StressLoadImage : public LoadImage {
+public:
+  StressLoadImage(void) : LoadImage("stress") {}	///< Constructor
+  virtual void loadFill(uint1 *ptr,int4 size,const Address &addr) { memset(ptr,0,size); }
+  virtual string getArchType(void) const { return "stress"; }
+  virtual void adjustVma(long adjust) {}
+};
+
+/// \brief Architecture tying the synthetic translator to minimal processor and compiler specs
+class StressArchitecture : public Architecture {
+  int4 links;			///< Number of links in the chain
+protected:
+  virtual Translate *buildTranslator(DocumentStorage &store) { return new StressTranslate(links); }
+  virtual void buildLoader(DocumentStorage &store) { loader = new StressLoadImage(); }
+  virtual PcodeInjectLibrary *buildPcodeInjectLibrary(void) { return new PcodeInjectLibrarySleigh(this,0x2000); }
+  virtual void buildSpecFile(DocumentStorage &store);
+  virtual void modifySpaces(Translate *trans) {}
+  virtual void resolveArchitecture(void) { archid = "stress"; }
+public:
+  StressArchitecture(int4 n) { links = n; }	///< Constructor
+  virtual void printMessage(const string &message) const { cerr << message << endl; }
+};
+
+void StressArchitecture::buildSpecFile(DocumentStorage &store)
+
+{
+  istringstream pspec("<processor_spec/>");
+  store.registerTag(store.parseDocument(pspec)->getRoot());
+  istringstream cspec(
+    "<compiler_spec>"
+    "<global><range space=\"ram\"/></global>"
+    "<stackpointer register=\"sp\" space=\"ram\"/>"
+    "<default_proto>"
+    "<prototype name=\"__stress\" extrapop=\"0\" stackshift=\"0\">"
+    "<input><pentry minsize=\"1\" maxsize=\"4\"><register name=\"r3\"/></pentry></input>"
+    "<output><pentry minsize=\"1\" maxsize=\"4\"><register name=\"r0\"/></pentry></output>"
+    "</prototype>"
+    "</default_proto>"
+    "</compiler_spec>");
+  store.registerTag(store.parseDocument(cspec)->getRoot());
+}
+
+/// \brief The function under test, and the outcome of processing it on the worker thread
+struct StressRun {
+  Funcdata *fd;			///< The synthetic function
+  string error;			///< Error message if processing threw
+};
+
+/// \param arg is the StressRun
+/// \return \b null
+static void *runHeritage(void *arg)
+
+{
+  StressRun *run = (StressRun *)arg;
+  try {
+    run->fd->startProcessing();
+    run->fd->opHeritage();
+  }
+  catch(LowlevelError &err) {
+    run->error = err.explain;
+  }
+  return (void *)0;
+}
+
+int main(int argc,char **argv)
+
+{
+  int4 links = (argc > 1) ? atoi(argv[1]) : 100000;
+  int4 stackkb = (argc > 2) ? atoi(argv[2]) : 256;
+
+  CapabilityPoint::initializeAll();
+  StressArchitecture arch(links);
+  DocumentStorage store;
+  StressRun run;
+  try {
+    arch.init(store);
+    Scope *global = arch.symboltab->getGlobalScope();
+    global->addFunction(Address(arch.getDefaultSpace(),0),"chain");
+    run.fd = global->queryFunction("chain");
+  }
+  catch(LowlevelError &err) {
+    cerr << err.explain << endl;
+    return 1;
+  }
+  if (run.fd == (Funcdata *)0) {
+    cerr << "Could not create the function" << endl;
+    return 1;
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr,(size_t)stackkb * 1024);
+  pthread_t thread;
+  clock_t start = clock();
+  if (pthread_create(&thread,&attr,runHeritage,&run) != 0) {
+    cerr << "Could not start a thread with a " << dec << stackkb << "KB stack" << endl;
+    return 1;
+  }
+  pthread_join(thread,(void **)0);
+  double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+  if (!run.error.empty()) {
+    cerr << "FAIL: " << run.error << endl;
+    return 1;
+  }
+
+  Funcdata *fd = run.fd;
+  const BlockGraph &bblocks( fd->getBasicBlocks() );
+  int4 depth = 0;
+  for(FlowBlock *bl=bblocks.getBlock(bblocks.getSize()-1);bl->getImmedDom()!=(FlowBlock *)0;bl=bl->getImmedDom())
+    depth += 1;
+  int4 multi = 0;
+  PcodeOp *addop = (PcodeOp *)0;
+  list<PcodeOp *>::const_iterator iter;
+  for(iter=fd->beginOpAlive();iter!=fd->endOpAlive();++iter) {
+    PcodeOp *op = *iter;
+    if (op->code() == CPUI_MULTIEQUAL)
+      multi += 1;
+    else if (op->code() == CPUI_INT_ADD && op->getAddr().getOffset() == 1 + 2*(uintb)links)
+      addop = op;
+  }
+  cout << dec << bblocks.getSize() << " blocks, dominator depth " << depth << ", ";
+  cout << multi << " MULTIEQUALs, " << secs << "s on a " << stackkb << "KB stack" << endl;
+
+  int4 fails = 0;
+  if (depth < links) {
+    cout << "FAIL: expected a dominator chain of at least " << links << " links" << endl;
+    fails += 1;
+  }
+  // One MULTIEQUAL for r1 at the head of every link after the first and at the final block,
+  // and one for r0 at the final block, which loops back to itself
+  if (multi != links + 1) {
+    cout << "FAIL: expected " << links + 1 << " MULTIEQUALs" << endl;
+    fails += 1;
+  }
+  if (addop == (PcodeOp *)0 || !addop->getIn(0)->isWritten() ||
+      addop->getIn(0)->getDef()->code() != CPUI_MULTIEQUAL) {
+    cout << "FAIL: the final read of r1 is not defined by a MULTIEQUAL" << endl;
+    fails += 1;
+  }
+  if (fails == 0)
+    cout << "PASS" << endl;
+  return (fails == 0) ? 0 : 1;
+}
@@ -39,18 +39,45 @@ void ida_arch::buildLoader(DocumentStorage &store) {
    loader = new ida_load_image(this);
 }
 
+//bulk import of IDA's no-return analysis. Without it every call to an exit-like function
+//is followed into whatever bytes come after it and later actions have to clean up the
+//extra flow, heritage and dead code
 void ida_arch::postSpecFile(void) {
-/*
+   buildGlobalScope();
    size_t nfuncs = get_func_qty();
+   int count = 0;
    for (size_t i = 0; i < nfuncs; i++) {
-      void *f = getn_func(i);
-      uint64_t func_ea = get_func_start(f);
+      func_t *f = getn_func(i);
       if (!does_func_return(f)) {
-         Funcdata *infd = symboltab->getGlobalScope()->queryFunction(Address(getDefaultSpace(), func_ea));
-         infd->getFuncProto().setNoReturn(true);
+         if (setNoReturn(get_func_start(f), true)) {
+            count++;
+         }
       }
    }
-*/
+   if (count) {
+      msg("Imported %d non-returning functions\n", count);
+   }
+}
+
+bool ida_arch::setNoReturn(uint64_t ea, bool val) {
+   Address addr(getDefaultSpace(), ea);
+   Scope *globscope = symboltab->getGlobalScope();
+   Funcdata *fd;
+   if (val) {
+      fd = globscope->queryFunction(addr);
+   }
+   else {
+      //only functions already in the cache can be carrying the flag
+      ScopeInternal *cached = dynamic_cast<ScopeInternal *>(globscope);
+      fd = cached ? cached->ScopeInternal::findFunction(addr) : NULL;
+   }
+   if (fd == NULL) {
+      return false;
+   }
+   fd->getFuncProto().setNoReturn(val);
+   protocache->erase(addr);   //a cached copy would still carry the old flag
+   jumpcache->clear();        //flow through callers of this function may have changed
+   return true;
 }
 
 Scope *ida_arch::buildGlobalScope(void) {
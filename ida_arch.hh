@@ -39,6 +39,10 @@ class ida_arch : public SleighArchitecture {
 public:
    ida_arch(const string &fname,const string &targ,ostream *estream) : SleighArchitecture(fname, targ, estream) {};
 
+   //set or clear the no-return property of the function at ea. A function the decompiler
+   //has not seen yet is only created when setting the property
+   bool setNoReturn(uint64_t ea, bool val);
+
 protected:
    /// \brief Build the LoadImage object and load the executable image
    ///
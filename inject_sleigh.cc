@@ -17,6 +17,109 @@
 #include "pcodeparse.hh"
 #include "architecture.hh"
 
+/// \param start is the first op whose pointers need to be recomputed
+void InjectBlock::repoint(int4 start)
+
+{
+  for(int4 i=start;i<ops.size();++i) {
+    PcodeData &op(ops[i]);
+    int4 pos = poolpos[i];
+    if (op.outvar != (VarnodeData *)0)
+      op.outvar = &pool[pos++];
+    op.invar = (op.isize > 0) ? &pool[pos] : (VarnodeData *)0;
+  }
+}
+
+void InjectBlock::clear(void)
+
+{
+  addr.clear();
+  ops.clear();
+  pool.clear();
+  poolpos.clear();
+  keyspace = (AddrSpace *)0;
+  keyin.clear();
+  keyout.clear();
+  valid = false;
+}
+
+/// The base address space and the storage of the input and output parameters
+/// are everything an address independent template depends on.
+/// \param con is the context of the injection that produced \b this block
+void InjectBlock::setKey(const InjectContext &con)
+
+{
+  keyspace = con.baseaddr.getSpace();
+  keyin = con.inputlist;
+  keyout = con.output;
+  valid = true;
+}
+
+/// \param con is the context of the injection about to be performed
+/// \return \b true if replaying \b this block is equivalent to walking the template again
+bool InjectBlock::matches(const InjectContext &con) const
+
+{
+  if (!valid) return false;
+  if (keyspace != con.baseaddr.getSpace()) return false;
+  return (keyin == con.inputlist && keyout == con.output);
+}
+
+/// \param baseaddr is the address to associate with every op
+/// \param emt is the emitter receiving the ops
+void InjectBlock::emit(const Address &baseaddr,PcodeEmit &emt) const
+
+{
+  if (ops.empty()) return;
+  emt.dumpBlock(baseaddr,&ops[0],ops.size());
+}
+
+/// Consecutive ops sharing an address are passed on as a single block.
+/// \param emt is the emitter receiving the ops
+void InjectBlock::replay(PcodeEmit &emt) const
+
+{
+  int4 i = 0;
+  while(i<ops.size()) {
+    int4 j = i + 1;
+    while(j<ops.size() && addr[j] == addr[i])
+      j += 1;
+    emt.dumpBlock(addr[i],&ops[i],j-i);
+    i = j;
+  }
+}
+
+void InjectBlock::dump(const Address &a,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)
+
+{
+  PcodeData op;
+  op.opc = opc;
+  op.outvar = outvar;
+  op.invar = vars;
+  op.isize = isize;
+  dumpBlock(a,&op,1);
+}
+
+void InjectBlock::dumpBlock(const Address &a,const PcodeData *src,int4 numops)
+
+{
+  const VarnodeData *oldbase = pool.empty() ? (const VarnodeData *)0 : &pool[0];
+  int4 start = ops.size();
+  for(int4 i=0;i<numops;++i) {
+    const PcodeData &op(src[i]);
+    addr.push_back(a);
+    poolpos.push_back(pool.size());
+    if (op.outvar != (VarnodeData *)0)
+      pool.push_back(*op.outvar);
+    for(int4 j=0;j<op.isize;++j)
+      pool.push_back(op.invar[j]);
+    ops.push_back(op);
+  }
+  if (!pool.empty() && oldbase != (const VarnodeData *)0 && oldbase != &pool[0])
+    start = 0;				// Pool was reallocated, earlier ops point at freed storage
+  repoint(start);
+}
+
 InjectContextSleigh::~InjectContextSleigh(void)
 
 {
@@ -36,6 +139,7 @@ InjectPayloadSleigh::InjectPayloadSleigh(const string &src,const string &nm,int4
 {
   source = src;
   tpl = (ConstructTpl *)0;
+  addrindependent = false;
   paramshift = 0;
 }
 
@@ -43,22 +147,7 @@ void InjectPayloadSleigh::inject(InjectContext &context,PcodeEmit &emit) const
 
 {
   InjectContextSleigh &con((InjectContextSleigh &)context);
-
-  con.cacher.clear();
-
-  con.pos->setAddr(con.baseaddr);
-  con.pos->setNaddr(con.nextaddr);
-  con.pos->setCalladdr(con.calladdr);
-
-  ParserWalkerChange walker(con.pos);
-  con.pos->deallocateState(walker);
-  setupParameters(con,walker,inputlist,output,source);
-  // delayslot and crossbuild directives are not allowed in snippets, so we don't need the DisassemblyCache
-  // and we don't need a unique allocation mask
-  SleighBuilder builder(&walker,(DisassemblyCache *)0,&con.cacher,con.glb->getConstantSpace(),con.glb->getUniqueSpace(),0);
-  builder.build(tpl,-1);
-  con.cacher.resolveRelatives();
-  con.cacher.emit(con.baseaddr,&emit);
+  instantiate(con,emit,tpl,addrindependent,memo,inputlist,output,source);
 }
 
 void InjectPayloadSleigh::restoreXml(const Element *el)
@@ -133,6 +222,104 @@ void InjectPayloadSleigh::setupParameters(InjectContextSleigh &con,ParserWalkerC
   }
 }
 
+/// \brief Check if a constant template can depend on the address of the injection
+///
+/// \param c is the constant template
+/// \return \b true if the constant is filled in from the instruction or flow addresses
+static bool isAddressConstant(const ConstTpl &c)
+
+{
+  switch(c.getType()) {
+  case ConstTpl::j_start:
+  case ConstTpl::j_next:
+  case ConstTpl::j_flowref:
+  case ConstTpl::j_flowref_size:
+  case ConstTpl::j_flowdest:
+  case ConstTpl::j_flowdest_size:
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
+/// \brief Check if a varnode template can depend on the address of the injection
+///
+/// \param vn is the varnode template (may be null)
+/// \return \b true if any field is filled in from the instruction or flow addresses
+static bool isAddressVarnode(const VarnodeTpl *vn)
+
+{
+  if (vn == (const VarnodeTpl *)0) return false;
+  return (isAddressConstant(vn->getSpace()) || isAddressConstant(vn->getOffset()) ||
+	  isAddressConstant(vn->getSize()));
+}
+
+/// A template that never refers to \e inst_start, \e inst_next, or the flow addresses
+/// builds the same p-code at every site, given the same parameters and address space.
+/// Relative branches are resolved as op counts, so they don't break independence.
+/// \param tpl is the compiled template
+/// \return \b true if instantiations can be reused across addresses
+bool InjectPayloadSleigh::isAddressIndependent(const ConstructTpl *tpl)
+
+{
+  if (tpl == (const ConstructTpl *)0) return false;
+  const vector<OpTpl *> &opvec(tpl->getOpvec());
+  for(int4 i=0;i<opvec.size();++i) {
+    const OpTpl *op = opvec[i];
+    if (isAddressVarnode(op->getOut())) return false;
+    for(int4 j=0;j<op->numInput();++j)
+      if (isAddressVarnode(op->getIn(j))) return false;
+  }
+  return true;
+}
+
+/// Walk the template with the parameters in the given context and emit the resulting p-code.
+/// If the template is address independent, the result is kept in \e memo, and a later
+/// injection with the same parameters replays it at the new address without a walk.
+/// Fixups like stack checks and get_pc thunks are applied at many call sites with identical storage.
+/// \param con is the context for the injection
+/// \param emit is the emitter receiving the p-code
+/// \param tpl is the compiled template
+/// \param addrindependent is \b true if \e tpl doesn't depend on the injection address
+/// \param memo holds the most recent instantiation of \e tpl
+/// \param inputlist is the list of input parameters of the payload
+/// \param output is the list of output parameters of the payload
+/// \param source is a description of the payload for error messages
+void InjectPayloadSleigh::instantiate(InjectContextSleigh &con,PcodeEmit &emit,ConstructTpl *tpl,
+				      bool addrindependent,InjectBlock &memo,
+				      const vector<InjectParameter> &inputlist,
+				      const vector<InjectParameter> &output,
+				      const string &source)
+{
+  if (addrindependent && memo.matches(con)) {
+    memo.emit(con.baseaddr,emit);
+    return;
+  }
+  con.cacher.clear();
+
+  con.pos->setAddr(con.baseaddr);
+  con.pos->setNaddr(con.nextaddr);
+  con.pos->setCalladdr(con.calladdr);
+
+  ParserWalkerChange walker(con.pos);
+  con.pos->deallocateState(walker);
+  setupParameters(con,walker,inputlist,output,source);
+  // delayslot and crossbuild directives are not allowed in snippets, so we don't need the DisassemblyCache
+  // and we don't need a unique allocation mask
+  SleighBuilder builder(&walker,(DisassemblyCache *)0,&con.cacher,con.glb->getConstantSpace(),con.glb->getUniqueSpace(),0);
+  builder.build(tpl,-1);
+  con.cacher.resolveRelatives();
+  if (!addrindependent) {
+    con.cacher.emit(con.baseaddr,&emit);
+    return;
+  }
+  memo.clear();
+  con.cacher.emit(con.baseaddr,&memo);
+  memo.setKey(con);
+  memo.emit(con.baseaddr,emit);
+}
+
 InjectPayloadCallfixup::InjectPayloadCallfixup(const string &sourceName)
   : InjectPayloadSleigh(sourceName,"unknown",CALLFIXUP_TYPE)
 {
@@ -180,6 +367,7 @@ ExecutablePcodeSleigh::ExecutablePcodeSleigh(Architecture *g,const string &src,c
   : ExecutablePcode(g,src,nm)
 {
   tpl = (ConstructTpl *)0;
+  addrindependent = false;
 }
 
 ExecutablePcodeSleigh::~ExecutablePcodeSleigh(void)
@@ -193,22 +381,7 @@ void ExecutablePcodeSleigh::inject(InjectContext &context,PcodeEmit &emit) const
 
 {
   InjectContextSleigh &con((InjectContextSleigh &)context);
-
-  con.cacher.clear();
-
-  con.pos->setAddr(con.baseaddr);
-  con.pos->setNaddr(con.nextaddr);
-  con.pos->setCalladdr(con.calladdr);
-
-  ParserWalkerChange walker(con.pos);
-  con.pos->deallocateState(walker);
-  InjectPayloadSleigh::setupParameters(con,walker,inputlist,output,getSource());
-  // delayslot and crossbuild directives are not allowed in snippets, so we don't need the DisassemblyCache
-  // and we don't need a unique allocation mask
-  SleighBuilder builder(&walker,(DisassemblyCache *)0,&con.cacher,con.glb->getConstantSpace(),con.glb->getUniqueSpace(),0);
-  builder.build(tpl,-1);
-  con.cacher.resolveRelatives();
-  con.cacher.emit(con.baseaddr,&emit);
+  InjectPayloadSleigh::instantiate(con,emit,tpl,addrindependent,memo,inputlist,output,getSource());
 }
 
 void ExecutablePcodeSleigh::restoreXml(const Element *el)
@@ -238,7 +411,7 @@ void ExecutablePcodeSleigh::printTemplate(ostream &s) const
 InjectPayloadDynamic::~InjectPayloadDynamic(void)
 
 {
-  map<Address,Document *>::iterator iter;
+  map<Address,InjectBlock *>::iterator iter;
   for(iter=addrMap.begin();iter!=addrMap.end();++iter)
     delete (*iter).second;
 }
@@ -253,29 +426,38 @@ void InjectPayloadDynamic::restoreEntry(const Element *el)
   Address addr = Address::restoreXml(*iter,glb);
   ++iter;
   istringstream s((*iter)->getContent());
+  Document *doc;
   try {
-    Document *doc = xml_tree(s);
-    map<Address,Document *>::iterator iter = addrMap.find(addr);
-    if (iter != addrMap.end())
-      delete (*iter).second;		// Delete any preexisting document
-    addrMap[addr] = doc;
+    doc = xml_tree(s);
   }
   catch(XmlError &err) {
     throw LowlevelError("Error in dynamic payload XML");
   }
+  InjectBlock *block = new InjectBlock();	// Parse the ops once, rather than at every inject
+  try {
+    const List &oplist(doc->getRoot()->getChildren());
+    for(List::const_iterator oiter=oplist.begin();oiter!=oplist.end();++oiter)
+      block->restoreXmlOp(*oiter,glb->translate);
+  }
+  catch(LowlevelError &err) {
+    delete block;
+    delete doc;
+    throw;
+  }
+  delete doc;
+  map<Address,InjectBlock *>::iterator miter = addrMap.find(addr);
+  if (miter != addrMap.end())
+    delete (*miter).second;		// Delete any preexisting block
+  addrMap[addr] = block;
 }
 
 void InjectPayloadDynamic::inject(InjectContext &context,PcodeEmit &emit) const
 
 {
-  map<Address,Document *>::const_iterator eiter = addrMap.find(context.baseaddr);
+  map<Address,InjectBlock *>::const_iterator eiter = addrMap.find(context.baseaddr);
   if (eiter == addrMap.end())
     throw LowlevelError("Missing dynamic inject");
-  const Element *el = (*eiter).second->getRoot();
-  const List &list(el->getChildren());
-  List::const_iterator iter;
-  for(iter=list.begin();iter!=list.end();++iter)
-    emit.restoreXmlOp(*iter,glb->translate);
+  (*eiter).second->replay(emit);
 }
 
 PcodeInjectLibrarySleigh::PcodeInjectLibrarySleigh(Architecture *g,uintb tmpbase)
@@ -324,6 +506,7 @@ void PcodeInjectLibrarySleigh::parseInject(InjectPayload *payload)
     if (!compiler.parseStream(s))
       throw LowlevelError(payload->getSource() + ": Unable to compile pcode: "+compiler.getErrorMessage());
     sleighpayload->tpl = compiler.releaseResult();
+    sleighpayload->addrindependent = InjectPayloadSleigh::isAddressIndependent(sleighpayload->tpl);
     sleighpayload->parsestring = "";		// No longer need the memory
   }
   else {
@@ -334,6 +517,7 @@ void PcodeInjectLibrarySleigh::parseInject(InjectPayload *payload)
       throw LowlevelError(payload->getSource() + ": Unable to compile pcode: "+compiler.getErrorMessage());
     tempbase = compiler.getUniqueBase();
     sleighpayload->tpl = compiler.releaseResult();
+    sleighpayload->addrindependent = InjectPayloadSleigh::isAddressIndependent(sleighpayload->tpl);
     sleighpayload->parsestring = "";		// No longer need the memory
   }
 }
@@ -28,11 +28,41 @@ public:
   virtual void saveXml(ostream &s) const {}	// We don't need this functionality for sleigh
 };
 
+/// \brief An owned copy of a block of p-code emitted by an injection
+///
+/// The block is filled through the PcodeEmit interface and can be replayed into
+/// any other emitter, either at the address each op was recorded with or at a new address.
+/// For sleigh payloads the block also remembers the parameters it was instantiated with,
+/// so a later injection with the same parameters can skip walking the template.
+class InjectBlock : public PcodeEmit {
+  vector<Address> addr;			///< Address associated with each op
+  vector<PcodeData> ops;		///< The recorded ops (pointers are into -pool-)
+  vector<VarnodeData> pool;		///< Storage for every output and input varnode
+  vector<int4> poolpos;			///< Start of each op's varnodes in -pool-
+  AddrSpace *keyspace;			///< Space of the base address the block was built at
+  vector<VarnodeData> keyin;		///< Input parameters the block was built with
+  vector<VarnodeData> keyout;		///< Output parameters the block was built with
+  bool valid;				///< True if the key is set
+  void repoint(int4 start);		///< Recompute op pointers into the pool
+public:
+  InjectBlock(void) { keyspace = (AddrSpace *)0; valid = false; }	///< Construct an empty block
+  void clear(void);			///< Drop all recorded ops and the key
+  void setKey(const InjectContext &con);	///< Record the parameters of the given injection
+  bool matches(const InjectContext &con) const;	///< Was \b this built with the same parameters
+  bool empty(void) const { return ops.empty(); }	///< Return \b true if no ops have been recorded
+  void emit(const Address &baseaddr,PcodeEmit &emt) const;	///< Replay all ops at the given address
+  void replay(PcodeEmit &emt) const;	///< Replay all ops at their recorded addresses
+  virtual void dump(const Address &a,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize);
+  virtual void dumpBlock(const Address &a,const PcodeData *src,int4 numops);
+};
+
 class InjectPayloadSleigh : public InjectPayload {
   friend class PcodeInjectLibrarySleigh;
   ConstructTpl *tpl;
   string parsestring;
   string source;
+  bool addrindependent;		///< True if the template produces the same p-code at every address
+  mutable InjectBlock memo;	///< P-code from the most recent instantiation
 public:
   InjectPayloadSleigh(const string &src,const string &nm,int4 tp);
   virtual ~InjectPayloadSleigh(void);
@@ -46,6 +76,11 @@ public:
   static void setupParameters(InjectContextSleigh &con,ParserWalkerChange &walker,
 			      const vector<InjectParameter> &inputlist,const vector<InjectParameter> &output,
 			      const string &source);
+  static bool isAddressIndependent(const ConstructTpl *tpl);
+  static void instantiate(InjectContextSleigh &con,PcodeEmit &emit,ConstructTpl *tpl,
+			  bool addrindependent,InjectBlock &memo,
+			  const vector<InjectParameter> &inputlist,const vector<InjectParameter> &output,
+			  const string &source);
 };
 
 class InjectPayloadCallfixup : public InjectPayloadSleigh {
@@ -66,6 +101,8 @@ class ExecutablePcodeSleigh : public ExecutablePcode {
 protected:
   string parsestring;
   ConstructTpl *tpl;
+  bool addrindependent;		///< True if the template produces the same p-code at every address
+  mutable InjectBlock memo;	///< P-code from the most recent instantiation
  public:
   ExecutablePcodeSleigh(Architecture *g,const string &src,const string &nm);
   virtual ~ExecutablePcodeSleigh(void);
@@ -76,7 +113,7 @@ protected:
 
 class InjectPayloadDynamic : public InjectPayload {
   Architecture *glb;
-  map<Address,Document *> addrMap;		// Map from address to specific inject
+  map<Address,InjectBlock *> addrMap;		// Map from address to specific inject, parsed once
 public:
   InjectPayloadDynamic(Architecture *g,const string &nm,int4 tp) : InjectPayload(nm,tp) { glb = g; dynamic = true; }
   virtual ~InjectPayloadDynamic(void);
@@ -16,6 +16,7 @@
 #include "jumptable.hh"
 #include "emulate.hh"
 #include "flow.hh"
+#include "crc32.hh"
 
 void LoadTable::saveXml(ostream &s) const
 
@@ -2354,3 +2355,99 @@ bool JumpTable::checkForMultistage(Funcdata *fd)
   }
   return false;
 }
+
+bool JumpTableCache::calcDataCrc(const vector<LoadTable> &loads,uint4 &res) const
+
+{ // CRC the bytes of every table the addresses were loaded from, false if any are unavailable
+  uint1 buf[256];
+  res = 0x12345678;
+  for(int4 i=0;i<loads.size();++i) {
+    const LoadTable &load( loads[i] );
+    int4 remain = load.size * load.num;
+    Address curaddr = load.addr;
+    while(remain > 0) {
+      int4 chunk = (remain > sizeof(buf)) ? sizeof(buf) : remain;
+      try {
+	glb->loader->loadFill(buf,chunk,curaddr);
+      }
+      catch(DataUnavailError &err) {
+	return false;
+      }
+      for(int4 j=0;j<chunk;++j)
+	res = crc_update(res,buf[j]);
+      curaddr = curaddr + chunk;
+      remain -= chunk;
+    }
+  }
+  return true;
+}
+
+const JumpTable *JumpTableCache::find(const Address &funcaddr,const Address &opaddr,uint4 crc) const
+
+{ // Return the cached table for the switch at -opaddr-, if it was recovered from identical code and data
+  map<pair<Address,Address>,Entry>::const_iterator iter = cache.find(pair<Address,Address>(funcaddr,opaddr));
+  if (iter == cache.end()) return (const JumpTable *)0;
+  const Entry &entry( (*iter).second );
+  if (entry.crc != crc) return (const JumpTable *)0;
+  uint4 datacrc;
+  if (!calcDataCrc(entry.table->getLoadPoints(),datacrc) || datacrc != entry.datacrc)
+    return (const JumpTable *)0;
+  return entry.table;
+}
+
+void JumpTableCache::store(const Address &funcaddr,const JumpTable *jt,uint4 crc)
+
+{ // Cache a partial clone of a fully recovered table, replacing any stale entry
+  // A table whose loads were not collected (JumpBasic2, JumpAssisted) can't be checked against
+  // its data, so only an override, which reads no table data, is cached without load points
+  if (jt->getLoadPoints().empty() && !jt->isOverride()) return;
+  uint4 datacrc;
+  if (!calcDataCrc(jt->getLoadPoints(),datacrc)) return;
+  Entry &entry( cache[pair<Address,Address>(funcaddr,jt->getOpAddress())] );
+  if (entry.table != (JumpTable *)0)
+    delete entry.table;
+  entry.crc = crc;
+  entry.datacrc = datacrc;
+  entry.table = new JumpTable(jt);
+}
+
+void JumpTableCache::eraseFunction(const Address &funcaddr)
+
+{ // Drop every table recovered within the given function
+  map<pair<Address,Address>,Entry>::iterator iter = cache.lower_bound(pair<Address,Address>(funcaddr,Address()));
+  while(iter != cache.end() && (*iter).first.first == funcaddr) {
+    delete (*iter).second.table;
+    cache.erase(iter++);
+  }
+}
+
+void JumpTableCache::eraseData(const Address &addr)
+
+{ // Drop every table whose addresses were loaded from bytes covering -addr-
+  map<pair<Address,Address>,Entry>::iterator iter = cache.begin();
+  while(iter != cache.end()) {
+    const vector<LoadTable> &loads( (*iter).second.table->getLoadPoints() );
+    bool covered = false;
+    for(int4 i=0;i<loads.size();++i) {
+      if (addr.overlap(0,loads[i].addr,loads[i].size * loads[i].num) >= 0) {
+	covered = true;
+	break;
+      }
+    }
+    if (covered) {
+      delete (*iter).second.table;
+      cache.erase(iter++);
+    }
+    else
+      ++iter;
+  }
+}
+
+void JumpTableCache::clear(void)
+
+{
+  map<pair<Address,Address>,Entry>::iterator iter;
+  for(iter=cache.begin();iter!=cache.end();++iter)
+    delete (*iter).second.table;
+  cache.clear();
+}
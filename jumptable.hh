@@ -34,6 +34,7 @@ struct JumptableNotReachableError : public LowlevelError { // There are no legal
 
 class LoadTable {
   friend class EmulateFunction;
+  friend class JumpTableCache;
   Address addr;		// Starting address of table
   int4 size;			// Size of table entry
   int4 num;			// Number of entries in table;
@@ -394,6 +395,7 @@ public:
   void setMostCommonIndex(uint4 tableind);
   void setMostCommonBlock(uint4 bl) { mostcommon = bl; }
   void setLoadCollect(bool val) { collectloads = val; }
+  const vector<LoadTable> &getLoadPoints(void) const { return loadpoints; }
   void addBlockToSwitch(BlockBasic *bl,uintb lab);
   void switchOver(const FlowInfo &flow);
   uintb getLabelByIndex(int4 index) const { return label[index]; }
@@ -408,4 +410,27 @@ public:
   void restoreXml(const Element *el);
 };  
 
+class JumpTableCache {		// Recovered jumptables, reused across decompiles of the same code
+  struct Entry {
+    uint4 crc;			// CRC of the code flowed through when the table was recovered
+    uint4 datacrc;		// CRC of the table bytes the addresses were read from
+    JumpTable *table;		// Partial clone of the recovered table
+    Entry(void) { crc = 0; datacrc = 0; table = (JumpTable *)0; }
+  };
+  Architecture *glb;		// Architecture providing the loader for table bytes
+  bool enabled;			// True if recovered tables are cached and looked up
+  map<pair<Address,Address>,Entry> cache;	// Entries indexed by (function entry, BRANCHIND address)
+  bool calcDataCrc(const vector<LoadTable> &loads,uint4 &res) const;
+public:
+  JumpTableCache(Architecture *g) { glb = g; enabled = false; }
+  ~JumpTableCache(void) { clear(); }
+  bool isEnabled(void) const { return enabled; }
+  void setEnabled(bool val) { enabled = val; if (!val) clear(); }
+  const JumpTable *find(const Address &funcaddr,const Address &opaddr,uint4 crc) const;
+  void store(const Address &funcaddr,const JumpTable *jt,uint4 crc);
+  void eraseFunction(const Address &funcaddr);
+  void eraseData(const Address &addr);
+  void clear(void);
+};
+
 #endif
@@ -611,6 +611,389 @@ MemoryHashOverlay::MemoryHashOverlay(AddrSpace *spc,int4 ws,int4 ps,int4 hashsiz
   }
 }
 
+/// The initial contents of the array are pulled from the \e underlying bank, or are zero
+/// if there is no underlying bank.
+/// \param spc is the address space associated with the memory bank
+/// \param ws is the number of bytes in the preferred wordsize (must be power of 2)
+/// \param ps is the number of bytes in a page (must be a power of 2)
+/// \param sz is the minimum number of bytes to hold in the flat array
+/// \param ul is the underlying memory bank being overlayed
+MemoryFlatOverlay::MemoryFlatOverlay(AddrSpace *spc,int4 ws,int4 ps,uintb sz,MemoryBank *ul)
+  : MemoryBank(spc,ws,ps)
+{
+  underlie = ul;
+  datasize = (sz + ps - 1) & ~((uintb)(ps-1));	// Round up so pages never straddle the array end
+  if (datasize == 0)
+    datasize = ps;
+  data = new uint1[datasize];
+  if (underlie == (MemoryBank *)0)
+    memset(data,0,datasize);
+  else {
+    for(uintb pageaddr=0;pageaddr<datasize;pageaddr+=ps)
+      underlie->getPage(pageaddr,data+pageaddr,0,ps);
+  }
+}
+
+MemoryFlatOverlay::~MemoryFlatOverlay(void)
+
+{
+  delete [] data;
+}
+
+/// If the word lies within the flat array, it is written there directly.
+/// Otherwise the write is forwarded to the \e underlying bank.
+/// \param addr is the aligned address of the word being written
+/// \param val is the value of the word to write
+void MemoryFlatOverlay::insert(uintb addr,uintb val)
+
+{
+  if (addr < datasize) {
+    deconstructValue(data + addr,val,getWordSize(),getSpace()->isBigEndian());
+    return;
+  }
+  if (underlie == (MemoryBank *)0)
+    throw LowlevelError("Write past end of flat memory bank");
+  underlie->insert(addr,val);
+}
+
+/// If the word lies within the flat array, it is read directly.  Otherwise the query is
+/// forwarded to the \e underlying bank, or 0 is returned if there is no underlying bank.
+/// \param addr is the aligned address of the word to retrieve
+/// \return the retrieved value
+uintb MemoryFlatOverlay::find(uintb addr) const
+
+{
+  if (addr < datasize)
+    return constructValue(data + addr,getWordSize(),getSpace()->isBigEndian());
+  if (underlie == (MemoryBank *)0)
+    return (uintb)0;
+  return underlie->find(addr);
+}
+
+/// \param addr is the aligned offset of the page
+/// \param res is the pointer to where retrieved bytes should be stored
+/// \param skip is the offset \e into \e the \e page from where bytes should be retrieved
+/// \param size is the number of bytes to retrieve
+void MemoryFlatOverlay::getPage(uintb addr,uint1 *res,int4 skip,int4 size) const
+
+{
+  if (addr < datasize) {
+    memcpy(res,data+addr+skip,size);
+    return;
+  }
+  if (underlie == (MemoryBank *)0) {
+    for(int4 i=0;i<size;++i)
+      res[i] = 0;
+    return;
+  }
+  underlie->getPage(addr,res,skip,size);
+}
+
+/// \param addr is the aligned offset of the page to write
+/// \param val is a pointer to bytes to be written into the page
+/// \param skip is the offset \e into \e the \e page where bytes should be written
+/// \param size is the number of bytes to write
+void MemoryFlatOverlay::setPage(uintb addr,const uint1 *val,int4 skip,int4 size)
+
+{
+  if (addr < datasize) {
+    memcpy(data+addr+skip,val,size);
+    return;
+  }
+  if (underlie == (MemoryBank *)0)
+    throw LowlevelError("Write past end of flat memory bank");
+  underlie->setPage(addr,val,skip,size);
+}
+
+/// Only words whose value differs from the \e underlying bank are written, so the underlying
+/// bank sees the same inserts it would have seen had the writes gone to it directly, rather
+/// than one for every word in the array.  The underlying bank is not written to while the
+/// overlay is in place (except past the end of the array), so comparing against it is the same
+/// as comparing against the initial contents of the array.
+void MemoryFlatOverlay::writeBack(void)
+
+{
+  if (underlie == (MemoryBank *)0) return;
+  int4 ws = getWordSize();
+  bool bigendian = getSpace()->isBigEndian();
+  for(uintb addr=0;addr<datasize;addr+=ws) {
+    uintb val = constructValue(data + addr,ws,bigendian);
+    if (val != underlie->find(addr))
+      underlie->insert(addr,val);
+  }
+}
+
+/// The radix range is divided evenly among the three levels of the table.
+/// \param spc is the address space associated with the memory bank
+/// \param ws is the number of bytes in the preferred wordsize (must be power of 2)
+/// \param ps is the number of bytes in a page (must be a power of 2)
+/// \param ul is the underlying memory bank being overlayed
+/// \param readcache is \b true if pages should be copied from the underlying bank on first read
+MemoryPageTable::MemoryPageTable(AddrSpace *spc,int4 ws,int4 ps,MemoryBank *ul,bool readcache)
+  : MemoryBank(spc,ws,ps)
+{
+  underlie = ul;
+  cachereads = readcache && (ul != (MemoryBank *)0);
+  pageshift = 0;
+  while((1<<pageshift) < ps)
+    pageshift += 1;
+  int4 total = radix_bits - pageshift;
+  levelbits[2] = total / 3;
+  levelbits[1] = total / 3;
+  levelbits[0] = total - levelbits[1] - levelbits[2];
+  int4 num = 1 << levelbits[0];
+  root = new void *[num];
+  memset(root,0,num * sizeof(void *));
+  lastpageaddr = 0;
+  lastpage = (uint1 *)0;
+}
+
+MemoryPageTable::~MemoryPageTable(void)
+
+{
+  freeNode(root,0,levelbits);
+  map<uintb,uint1 *>::iterator iter;
+  for(iter=highpages.begin();iter!=highpages.end();++iter)
+    delete [] (*iter).second;
+}
+
+/// \param node is the table node to free
+/// \param level is the level of the node (0 is the root)
+/// \param bits is the number of index bits at each level
+void MemoryPageTable::freeNode(void **node,int4 level,const int4 *bits)
+
+{
+  int4 num = 1 << bits[level];
+  for(int4 i=0;i<num;++i) {
+    if (node[i] == (void *)0) continue;
+    if (level == 2)
+      delete [] (uint1 *)node[i];
+    else
+      freeNode((void **)node[i],level+1,bits);
+  }
+  delete [] node;
+}
+
+/// \param pageaddr is the aligned address of the page
+/// \return the page, or \b null if it has not been allocated
+uint1 *MemoryPageTable::findPage(uintb pageaddr) const
+
+{
+  if (lastpage != (uint1 *)0 && lastpageaddr == pageaddr)
+    return lastpage;
+  uint1 *res;
+  if ((pageaddr >> radix_bits) != 0) {
+    map<uintb,uint1 *>::const_iterator iter = highpages.find(pageaddr);
+    if (iter == highpages.end())
+      return (uint1 *)0;
+    res = (*iter).second;
+  }
+  else {
+    uintb pagenum = pageaddr >> pageshift;
+    void **node = root;
+    int4 shift = levelbits[1] + levelbits[2];
+    node = (void **)node[pagenum >> shift];
+    if (node == (void **)0) return (uint1 *)0;
+    shift = levelbits[2];
+    node = (void **)node[(pagenum >> shift) & ((1<<levelbits[1])-1)];
+    if (node == (void **)0) return (uint1 *)0;
+    res = (uint1 *)node[pagenum & ((1<<levelbits[2])-1)];
+    if (res == (uint1 *)0) return res;
+  }
+  lastpageaddr = pageaddr;
+  lastpage = res;
+  return res;
+}
+
+/// Any missing table nodes along the way are allocated.  The page contents are copied
+/// from the underlying bank, or zero filled if there is no underlying bank.
+/// \param pageaddr is the aligned address of the page
+/// \return the new page
+uint1 *MemoryPageTable::createPage(uintb pageaddr)
+
+{
+  int4 ps = getPageSize();
+  uint1 *pageptr = new uint1[ps];
+  if (underlie == (MemoryBank *)0)
+    memset(pageptr,0,ps);
+  else
+    underlie->getPage(pageaddr,pageptr,0,ps);
+  if ((pageaddr >> radix_bits) != 0)
+    highpages[pageaddr] = pageptr;
+  else {
+    uintb pagenum = pageaddr >> pageshift;
+    void **node = root;
+    int4 index = pagenum >> (levelbits[1] + levelbits[2]);
+    for(int4 level=1;level<3;++level) {
+      if (node[index] == (void *)0) {
+	int4 num = 1 << levelbits[level];
+	void **newnode = new void *[num];
+	memset(newnode,0,num * sizeof(void *));
+	node[index] = newnode;
+      }
+      node = (void **)node[index];
+      if (level == 1)
+	index = (pagenum >> levelbits[2]) & ((1<<levelbits[1])-1);
+      else
+	index = pagenum & ((1<<levelbits[2])-1);
+    }
+    node[index] = pageptr;
+  }
+  lastpageaddr = pageaddr;
+  lastpage = pageptr;
+  return pageptr;
+}
+
+/// If the page is not present and read caching is on, it is copied from the underlying bank.
+/// \param pageaddr is the aligned address of the page
+/// \return the page, or \b null if the read must be forwarded to the underlying bank
+uint1 *MemoryPageTable::readPage(uintb pageaddr) const
+
+{
+  uint1 *res = findPage(pageaddr);
+  if (res == (uint1 *)0 && cachereads)
+    res = const_cast<MemoryPageTable *>(this)->createPage(pageaddr);
+  return res;
+}
+
+/// \param addr is the aligned address of the word to be written
+/// \param val is the value to be written at that word
+void MemoryPageTable::insert(uintb addr,uintb val)
+
+{
+  uintb pageaddr = addr & ~((uintb)(getPageSize()-1));
+  uint1 *pageptr = findPage(pageaddr);
+  if (pageptr == (uint1 *)0)
+    pageptr = createPage(pageaddr);
+  deconstructValue(pageptr + (addr - pageaddr),val,getWordSize(),getSpace()->isBigEndian());
+}
+
+/// \param addr is the aligned offset of the word
+/// \return the retrieved value
+uintb MemoryPageTable::find(uintb addr) const
+
+{
+  uintb pageaddr = addr & ~((uintb)(getPageSize()-1));
+  const uint1 *pageptr = readPage(pageaddr);
+  if (pageptr == (const uint1 *)0) {
+    if (underlie == (MemoryBank *)0)
+      return (uintb)0;
+    return underlie->find(addr);
+  }
+  return constructValue(pageptr + (addr - pageaddr),getWordSize(),getSpace()->isBigEndian());
+}
+
+/// \param addr is the aligned offset of the page
+/// \param res is the pointer to where retrieved bytes should be stored
+/// \param skip is the offset \e into \e the \e page from where bytes should be retrieved
+/// \param size is the number of bytes to retrieve
+void MemoryPageTable::getPage(uintb addr,uint1 *res,int4 skip,int4 size) const
+
+{
+  const uint1 *pageptr = readPage(addr);
+  if (pageptr == (const uint1 *)0) {
+    if (underlie == (MemoryBank *)0) {
+      for(int4 i=0;i<size;++i)
+	res[i] = 0;
+      return;
+    }
+    underlie->getPage(addr,res,skip,size);
+    return;
+  }
+  memcpy(res,pageptr+skip,size);
+}
+
+/// \param addr is the aligned offset of the page to write
+/// \param val is a pointer to bytes to be written into the page
+/// \param skip is the offset \e into \e the \e page where bytes should be written
+/// \param size is the number of bytes to write
+void MemoryPageTable::setPage(uintb addr,const uint1 *val,int4 skip,int4 size)
+
+{
+  uint1 *pageptr = findPage(addr);
+  if (pageptr == (uint1 *)0)
+    pageptr = createPage(addr);
+  memcpy(pageptr+skip,val,size);
+}
+
+/// If the bytes lie in a single page, they are encoded directly into the page, using a native
+/// store for 2, 4 and 8 byte values when the space matches the host endianness.
+/// Otherwise the base class breaks the write into aligned words.
+/// \param offset is the start of the byte range to write
+/// \param size is the number of bytes in the range to write
+/// \param val is the value to be written
+void MemoryPageTable::setValue(uintb offset,int4 size,uintb val)
+
+{
+  uintb pagemask = (uintb)(getPageSize()-1);
+  uintb skip = offset & pagemask;
+  if (skip + size > getPageSize()) {
+    MemoryBank::setValue(offset,size,val);
+    return;
+  }
+  uintb pageaddr = offset - skip;
+  uint1 *pageptr = findPage(pageaddr);
+  if (pageptr == (uint1 *)0)
+    pageptr = createPage(pageaddr);
+  pageptr += skip;
+  if ((HOST_ENDIAN==1) == getSpace()->isBigEndian()) {
+    switch(size) {
+    case 1:
+      *pageptr = (uint1)val;
+      return;
+    case 2:
+      { uint2 tmp = (uint2)val; memcpy(pageptr,&tmp,2); }
+      return;
+    case 4:
+      { uint4 tmp = (uint4)val; memcpy(pageptr,&tmp,4); }
+      return;
+    case 8:
+      { uint8 tmp = (uint8)val; memcpy(pageptr,&tmp,8); }
+      return;
+    default:
+      break;
+    }
+  }
+  deconstructValue(pageptr,val,size,getSpace()->isBigEndian());
+}
+
+/// If the bytes lie in a single page that is present, they are decoded directly from the page,
+/// using a native load for 2, 4 and 8 byte values when the space matches the host endianness.
+/// Otherwise the base class breaks the read into aligned words.
+/// \param offset is the start of the byte range encoding the value
+/// \param size is the number of bytes in the range
+/// \return the decoded value
+uintb MemoryPageTable::getValue(uintb offset,int4 size) const
+
+{
+  uintb pagemask = (uintb)(getPageSize()-1);
+  uintb skip = offset & pagemask;
+  if (skip + size > getPageSize())
+    return MemoryBank::getValue(offset,size);
+  const uint1 *pageptr = readPage(offset - skip);
+  if (pageptr == (const uint1 *)0) {
+    if (underlie == (MemoryBank *)0)
+      return (uintb)0;
+    return underlie->getValue(offset,size);
+  }
+  pageptr += skip;
+  if ((HOST_ENDIAN==1) == getSpace()->isBigEndian()) {
+    switch(size) {
+    case 1:
+      return *pageptr;
+    case 2:
+      { uint2 tmp; memcpy(&tmp,pageptr,2); return tmp; }
+    case 4:
+      { uint4 tmp; memcpy(&tmp,pageptr,4); return tmp; }
+    case 8:
+      { uint8 tmp; memcpy(&tmp,pageptr,8); return tmp; }
+    default:
+      break;
+    }
+  }
+  return constructValue(pageptr,size,getSpace()->isBigEndian());
+}
+
 /// MemoryBanks associated with specific address spaces must be registers with this MemoryState
 /// via this method.  Each address space that will be used during emulation must be registered
 /// separately.  The MemoryState object does \e not assume responsibility for freeing the MemoryBank
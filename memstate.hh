@@ -36,6 +36,8 @@
 class MemoryBank {
   friend class MemoryPageOverlay;
   friend class MemoryHashOverlay;
+  friend class MemoryFlatOverlay;
+  friend class MemoryPageTable;
   int4 wordsize;		///< Number of bytes in an aligned word access
   int4 pagesize;		///< Number of bytes in an aligned page access
   AddrSpace *space;		///< The address space associated with this memory
@@ -51,8 +53,8 @@ public:
   int4 getPageSize(void) const;	///< Get the number of bytes in a page for this memory bank
   AddrSpace *getSpace(void) const; ///< Get the address space associated with this memory bank
   
-  void setValue(uintb offset,int4 size,uintb val); ///< Set the value of a (small) range of bytes
-  uintb getValue(uintb offset,int4 size) const; ///< Retrieve the value encoded in a (small) range of bytes
+  virtual void setValue(uintb offset,int4 size,uintb val); ///< Set the value of a (small) range of bytes
+  virtual uintb getValue(uintb offset,int4 size) const; ///< Retrieve the value encoded in a (small) range of bytes
   void setChunk(uintb offset,int4 size,const uint1 *val); ///< Set values of an arbitrary sequence of bytes
   void getChunk(uintb offset,int4 size,uint1 *res) const; ///< Retrieve an arbitrary sequence of bytes
   static uintb constructValue(const uint1 *ptr,int4 size,bool bigendian); ///< Decode bytes to value
@@ -138,6 +140,72 @@ public:
   MemoryHashOverlay(AddrSpace *spc,int4 ws,int4 ps,int4 hashsize,MemoryBank *ul); ///< Constructor for hash overlay
 };
 
+/// \brief A memory bank that keeps a bounded range of offsets in a single flat array.
+///
+/// Offsets from 0 up to the size of the array are read and written directly, with no
+/// page or hash lookup.  This is suitable for small spaces like \e register and \e unique.
+/// Accesses beyond the array are forwarded to an \e underlying memory bank, or read as zero
+/// if there is no underlying bank.  The raw array is exposed so that an emulator can resolve
+/// operands to byte pointers ahead of time.
+class MemoryFlatOverlay : public MemoryBank {
+  MemoryBank *underlie;		///< Underlying memory bank for offsets past the array
+  uint1 *data;			///< The flat array of bytes
+  uintb datasize;		///< Number of bytes in the array (a multiple of the page size)
+protected:
+  virtual void insert(uintb addr,uintb val); ///< Overridden aligned word insert
+  virtual uintb find(uintb addr) const;	///< Overridden aligned word find
+  virtual void getPage(uintb addr,uint1 *res,int4 skip,int4 size) const; ///< Overridden getPage
+  virtual void setPage(uintb addr,const uint1 *val,int4 skip,int4 size); ///< Overridden setPage
+public:
+  MemoryFlatOverlay(AddrSpace *spc,int4 ws,int4 ps,uintb sz,MemoryBank *ul); ///< Constructor for flat overlay
+  virtual ~MemoryFlatOverlay(void);
+  uint1 *getData(void) const { return data; }		///< Get the raw array of bytes
+  uintb getDataSize(void) const { return datasize; }	///< Get the number of bytes held in the array
+  MemoryBank *getUnderlie(void) const { return underlie; }	///< Get the underlying memory bank
+  void writeBack(void);		///< Write changed words back to the underlying bank
+};
+
+/// \brief A memory bank that finds its pages through a three-level radix table, using "copy on write".
+///
+/// The low 48 bits of the page address are split into three table indices, so a page is found
+/// with three array lookups and no tree walk or hash probe.  The most recently used page is also
+/// remembered.  Pages above the radix range (only possible in 64-bit spaces) are kept in a map.
+///
+/// Pages are copied from the \e underlying bank when first written, or when first read if \e read
+/// \e caching is turned on.  Read caching is appropriate when the underlying bank does not change,
+/// as with a MemoryImage over a LoadImage.  The underlying bank can be \b null, in which case
+/// this bank behaves as if it were initially filled with zeros.
+///
+/// Value accesses of any size that fall within a single page bypass the word decomposition of the
+/// base class and are decoded directly from the page.
+class MemoryPageTable : public MemoryBank {
+  enum {
+    radix_bits = 48		///< Number of low address bits covered by the radix table
+  };
+  MemoryBank *underlie;		///< Underlying memory bank
+  bool cachereads;		///< \b true if pages are copied from the underlying bank on read
+  int4 pageshift;		///< Number of bits in a page offset
+  int4 levelbits[3];		///< Number of index bits at each level of the table
+  void **root;			///< The top-level table
+  map<uintb,uint1 *> highpages;	///< Pages above the radix range
+  mutable uintb lastpageaddr;	///< Address of the most recently used page
+  mutable uint1 *lastpage;	///< The most recently used page (or \b null)
+  static void freeNode(void **node,int4 level,const int4 *bits);	///< Recursively free a table node
+  uint1 *findPage(uintb pageaddr) const;	///< Look up an existing page
+  uint1 *createPage(uintb pageaddr);		///< Allocate a page, filling it from the underlying bank
+  uint1 *readPage(uintb pageaddr) const;	///< Look up a page for reading, caching it if configured
+protected:
+  virtual void insert(uintb addr,uintb val); ///< Overridden aligned word insert
+  virtual uintb find(uintb addr) const;	///< Overridden aligned word find
+  virtual void getPage(uintb addr,uint1 *res,int4 skip,int4 size) const; ///< Overridden getPage
+  virtual void setPage(uintb addr,const uint1 *val,int4 skip,int4 size); ///< Overridden setPage
+public:
+  MemoryPageTable(AddrSpace *spc,int4 ws,int4 ps,MemoryBank *ul,bool readcache); ///< Constructor for page table
+  virtual ~MemoryPageTable(void);
+  virtual void setValue(uintb offset,int4 size,uintb val);	///< Set a value, directly within a page if possible
+  virtual uintb getValue(uintb offset,int4 size) const;		///< Get a value, directly within a page if possible
+};
+
 class Translate;		// Forward declaration
 
 /// \brief All storage/state for a pcode machine
@@ -79,6 +79,7 @@ OptionDatabase::OptionDatabase(Architecture *g)
   registerOption(new OptionSetLanguage());
   registerOption(new OptionJumpLoad());
   registerOption(new OptionToggleRule());
+  registerOption(new OptionAnalysisMemory());
 }
 
 OptionDatabase::~OptionDatabase(void)
@@ -784,3 +785,24 @@ string OptionToggleRule::apply(Architecture *glb,const string &p1,const string &
   }
   return res;
 }
+
+/// \class OptionAnalysisMemory
+/// \brief Set the memory ceiling for analysis kept by idle functions
+///
+/// The first parameter is the number of megabytes of (estimated) analysis state that functions
+/// may hold once they have been decompiled. Beyond this, the analysis of the least recently
+/// decompiled functions is released. A value of 0 removes the limit.
+string OptionAnalysisMemory::apply(Architecture *glb,const string &p1,const string &p2,const string &p3) const
+
+{
+  istringstream s(p1);
+  s.unsetf(ios::dec | ios::hex | ios::oct);
+  int4 val = -1;
+  s >> val;
+  if (val < 0)
+    throw ParseError("Must specify a non-negative number of megabytes");
+  glb->analysislru->setCeiling((uintb)val * 1024 * 1024);
+  if (val == 0)
+    return "Analysis memory is unlimited";
+  return "Analysis memory ceiling set to "+p1+" MB";
+}
@@ -54,13 +54,19 @@
 #include <fstream>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include "plugin.hh"
 #include "ast.hh"
 
+#include <chrono>
+
 #if defined(__NT__)                   // MS Windows
+#include <io.h>
+#include <fcntl.h>
 #define DIRSEP "\\"
 #else
+#include <unistd.h>
 #define DIRSEP "/"
 #endif
 
@@ -79,17 +85,161 @@ struct LocalVar {
       ghidra_name(gname), current_name(iname), offset(_offset) {};
 };
 
+//text of a decompiled function displayed in a custom_viewer. Lines are read out
+//of the render buffer only when the viewer paints them, lines brought up to date
+//after a rename are kept on the side
+struct FuncText {
+   RenderContext rc;
+   map<size_t, string> patched;
+
+   FuncText(size_t bytes, size_t lines) : rc(bytes, lines) {};
+
+   size_t size() const {return rc.num_lines();};
+   string get_line(size_t i) const;
+   void set_line(size_t i, const string &text) {patched[i] = text;};
+};
+
+string FuncText::get_line(size_t i) const {
+   map<size_t, string>::const_iterator pi = patched.find(i);
+   return pi != patched.end() ? pi->second : rc.get_line(i);
+}
+
+//a line number in a FuncText, the viewer's user data
+struct func_place_t : public place_t {
+   uval_t n;
+
+   static int class_id;
+
+   func_place_t(uval_t line = 0) : place_t(0), n(line) {};
+
+   static void register_class();
+
+   virtual void idaapi print(qstring *out_buf, void *ud) const;
+   virtual uval_t idaapi touval(void *ud) const {return n;};
+   virtual place_t *idaapi clone(void) const {return new func_place_t(*this);};
+   virtual void idaapi copyfrom(const place_t *from);
+   virtual place_t *idaapi makeplace(void *ud, uval_t x, int lnnum) const;
+   virtual int idaapi compare(const place_t *t2) const;
+   virtual void idaapi adjust(void *ud);
+   virtual bool idaapi prev(void *ud);
+   virtual bool idaapi next(void *ud);
+   virtual bool idaapi beginning(void *ud) const {return n == 0;};
+   virtual bool idaapi ending(void *ud) const;
+   virtual int idaapi generate(qstrvec_t *out, int *out_deflnnum, color_t *out_pfx_color,
+                               bgcolor_t *out_bgcolor, void *ud, int maxsize) const;
+   virtual void idaapi serialize(bytevec_t *out) const;
+   virtual bool idaapi deserialize(const uchar **pptr, const uchar *end);
+   virtual int idaapi id() const {return class_id;};
+   virtual const char *idaapi name() const {return "blc_func_place";};
+};
+
+int func_place_t::class_id = -1;
+
+void func_place_t::register_class() {
+   if (class_id == -1) {
+      func_place_t tmpl;
+      class_id = register_place_class(&tmpl, 0, &PLUGIN);
+   }
+}
+
+void idaapi func_place_t::print(qstring *out_buf, void *ud) const {
+   out_buf->sprnt("%u", (uint32)n);
+}
+
+void idaapi func_place_t::copyfrom(const place_t *from) {
+   const func_place_t *s = (const func_place_t *)from;
+   lnnum = s->lnnum;
+   n = s->n;
+}
+
+place_t *idaapi func_place_t::makeplace(void *ud, uval_t x, int lnnum) const {
+   func_place_t *p = new func_place_t(x);
+   p->lnnum = lnnum;
+   return p;
+}
+
+int idaapi func_place_t::compare(const place_t *t2) const {
+   const func_place_t *s = (const func_place_t *)t2;
+   return n < s->n ? -1 : (n > s->n ? 1 : 0);
+}
+
+void idaapi func_place_t::adjust(void *ud) {
+   FuncText *ft = (FuncText *)ud;
+   if (n >= ft->size()) {
+      n = ft->size() == 0 ? 0 : ft->size() - 1;
+   }
+   lnnum = 0;
+}
+
+bool idaapi func_place_t::prev(void *ud) {
+   if (n == 0) {
+      return false;
+   }
+   n--;
+   return true;
+}
+
+bool idaapi func_place_t::next(void *ud) {
+   if (ending(ud)) {
+      return false;
+   }
+   n++;
+   return true;
+}
+
+bool idaapi func_place_t::ending(void *ud) const {
+   FuncText *ft = (FuncText *)ud;
+   return n + 1 >= ft->size();
+}
+
+//one line per place, copied out of the render buffer only when it is painted
+int idaapi func_place_t::generate(qstrvec_t *out, int *out_deflnnum, color_t *out_pfx_color,
+                                  bgcolor_t *out_bgcolor, void *ud, int maxsize) const {
+   FuncText *ft = (FuncText *)ud;
+   if (n >= ft->size() || maxsize <= 0) {
+      return 0;
+   }
+   out->push_back(qstring(ft->get_line(n).c_str()));
+   *out_deflnnum = 0;
+   return 1;
+}
+
+void idaapi func_place_t::serialize(bytevec_t *out) const {
+   place_t__serialize(this, out);
+   append_ea(*out, n);
+}
+
+bool idaapi func_place_t::deserialize(const uchar **pptr, const uchar *end) {
+   if (!place_t__deserialize(this, pptr, end) || *pptr >= end) {
+      return false;
+   }
+   n = unpack_ea(pptr, end);
+   return true;
+}
+
+//line number of the cursor in a function viewer
+static bool get_cursor_line(TWidget *w, int *line, int *x = NULL) {
+   int cx;
+   int cy;
+   place_t *pl = get_custom_viewer_place(w, false, &cx, &cy);
+   if (pl == NULL || pl->id() != func_place_t::class_id) {
+      return false;
+   }
+   *line = (int)((func_place_t*)pl)->n;
+   if (x) {
+      *x = cx;
+   }
+   return true;
+}
+
 struct Decompiled {
    Function *ast;
    func_t *ida_func;
-   strvec_t *sv;       //text of the decompiled function displayed in a custom_viewer
+   FuncText *text;     //text of the decompiled function displayed in a custom_viewer
    map<string, LocalVar*> locals;
 
-   Decompiled(Function *f, func_t *func) : ast(f), ida_func(func), sv(NULL) {};
+   Decompiled(Function *f, func_t *func) : ast(f), ida_func(func), text(NULL) {};
    ~Decompiled();
-   
-   void set_ud(strvec_t *ud);
-   strvec_t *get_ud() {return sv;};
 };
 
 Decompiled::~Decompiled() {
@@ -97,12 +247,7 @@ Decompiled::~Decompiled() {
    for (map<string, LocalVar*>::iterator i = locals.begin(); i != locals.end(); i++) {
       delete i->second;
    }
-   delete sv;
-}
-
-void Decompiled::set_ud(strvec_t *ud) {
-   delete sv;
-   sv = ud;
+   delete text;
 }
 
 void decompile_at(ea_t ea, TWidget *w = NULL);
@@ -114,6 +259,169 @@ static map<TWidget*,string> views;
 static map<TWidget*,Decompiled*> function_map;
 static set<string> titles;
 
+//global name -> function -> lines on which the name appears. Built from every
+//decompilation and saved in the database so usages can be found without
+//decompiling the callers again
+#define REF_NODE "$ blc global refs"
+#define REF_SLOT_STRIDE 0x1000     //supvals reserved for each function's blob
+#define REF_SLOT_BYTES (REF_SLOT_STRIDE * MAXSPECSIZE)   //blob bytes that fit in a slot
+
+struct RefIndex {
+   map<string, map<uint64_t, vector<int> > > refs;
+   map<uint64_t, set<string> > funcs;   //names referenced by each indexed function
+
+   void update(uint64_t func, const vector<std::pair<string, int> > &globals);
+   void invalidate(uint64_t func);
+   void rename(const string &oldname, const string &newname);
+   void load();
+
+private:
+   void forget(uint64_t func);
+   void save(uint64_t func);
+};
+
+static RefIndex xrefs;
+
+//drop func's postings from memory only
+void RefIndex::forget(uint64_t func) {
+   map<uint64_t, set<string> >::iterator fi = funcs.find(func);
+   if (fi == funcs.end()) {
+      return;
+   }
+   for (set<string>::iterator ni = fi->second.begin(); ni != fi->second.end(); ni++) {
+      map<string, map<uint64_t, vector<int> > >::iterator ri = refs.find(*ni);
+      if (ri != refs.end()) {
+         ri->second.erase(func);
+         if (ri->second.empty()) {
+            refs.erase(ri);
+         }
+      }
+   }
+   funcs.erase(fi);
+}
+
+void RefIndex::update(uint64_t func, const vector<std::pair<string, int> > &globals) {
+   forget(func);
+   set<string> &names = funcs[func];
+   for (vector<std::pair<string, int> >::const_iterator gi = globals.begin(); gi != globals.end(); gi++) {
+      vector<int> &lines = refs[gi->first][func];
+      if (lines.empty() || lines.back() != gi->second) {
+         lines.push_back(gi->second);
+      }
+      names.insert(gi->first);
+   }
+   save(func);
+}
+
+void RefIndex::invalidate(uint64_t func) {
+   forget(func);
+   netnode nn(REF_NODE);
+   if (nn == BADNODE) {
+      return;
+   }
+   nodeidx_t slot = nn.altval(func, 'F');
+   if (slot) {
+      nn.delblob(slot * REF_SLOT_STRIDE, 'R');
+      nn.altdel(func, 'F');
+   }
+}
+
+void RefIndex::rename(const string &oldname, const string &newname) {
+   map<string, map<uint64_t, vector<int> > >::iterator ri = refs.find(oldname);
+   if (ri == refs.end() || oldname == newname) {
+      return;
+   }
+   map<uint64_t, vector<int> > moved;
+   moved.swap(ri->second);
+   refs.erase(ri);
+   map<uint64_t, vector<int> > &dest = refs[newname];
+   for (map<uint64_t, vector<int> >::iterator mi = moved.begin(); mi != moved.end(); mi++) {
+      vector<int> &lines = dest[mi->first];
+      lines.insert(lines.end(), mi->second.begin(), mi->second.end());
+      std::sort(lines.begin(), lines.end());
+      lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+      set<string> &names = funcs[mi->first];
+      names.erase(oldname);
+      names.insert(newname);
+      save(mi->first);
+   }
+}
+
+//one "name\tline,line,...\n" record per referenced name
+void RefIndex::save(uint64_t func) {
+   netnode nn(REF_NODE, 0, true);
+   nodeidx_t slot = nn.altval(func, 'F');
+   if (slot == 0) {
+      slot = nn.altval(0, 'N') + 1;
+      nn.altset(0, slot, 'N');
+      nn.altset(func, slot, 'F');
+   }
+   string text;
+   set<string> &names = funcs[func];
+   for (set<string>::iterator ni = names.begin(); ni != names.end(); ni++) {
+      vector<int> &lines = refs[*ni][func];
+      text += *ni;
+      char sep = '\t';
+      for (vector<int>::iterator li = lines.begin(); li != lines.end(); li++) {
+         char buf[16];
+         qsnprintf(buf, sizeof(buf), "%c%d", sep, *li);
+         text += buf;
+         sep = ',';
+      }
+      text += '\n';
+   }
+   if (text.length() > REF_SLOT_BYTES) {
+      //setblob would run into the next function's slot. Keep the whole records
+      //that fit, the rest are only known until the database is reopened
+      text.erase(text.rfind('\n', REF_SLOT_BYTES - 1) + 1);
+      msg("blc: global references of %a are too many to save, some will be lost on reopen\n",
+          (ea_t)func);
+   }
+   nn.delblob(slot * REF_SLOT_STRIDE, 'R');
+   nn.setblob(text.c_str(), text.length(), slot * REF_SLOT_STRIDE, 'R');
+}
+
+void RefIndex::load() {
+   refs.clear();
+   funcs.clear();
+   netnode nn(REF_NODE);
+   if (nn == BADNODE) {
+      return;
+   }
+   for (nodeidx_t func = nn.altfirst('F'); func != BADNODE; func = nn.altnext(func, 'F')) {
+      bytevec_t blob;
+      if (nn.getblob(&blob, nn.altval(func, 'F') * REF_SLOT_STRIDE, 'R') <= 0) {
+         continue;
+      }
+      string text((const char *)blob.begin(), blob.size());
+      set<string> &names = funcs[func];
+      size_t pos = 0;
+      while (pos < text.length()) {
+         size_t eol = text.find('\n', pos);
+         if (eol == string::npos) {
+            eol = text.length();
+         }
+         size_t tab = text.find('\t', pos);
+         if (tab != string::npos && tab < eol) {
+            string name = text.substr(pos, tab - pos);
+            vector<int> &lines = refs[name][func];
+            const char *cptr = text.c_str() + tab + 1;
+            const char *stop = text.c_str() + eol;
+            while (cptr < stop) {
+               char *next;
+               lines.push_back((int)strtol(cptr, &next, 10));
+               if (next == cptr) {
+                  break;
+               }
+               cptr = next + 1;   //skip the ',' or '\n'
+            }
+            names.insert(name);
+         }
+         pos = eol + 1;
+      }
+   }
+}
+
 arch_map_t arch_map;
 
 static string get_available_title() {
@@ -203,7 +511,6 @@ static bool navigate_to_word(TWidget *w, bool cursor) {
 static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
    ea_t addr = 0;
    if (shift == 0) {
-      strvec_t *sv = (strvec_t *)ud;
       switch (key) {
          case 'G':
             if (ask_addr(&addr, "Jump address")) {
@@ -218,6 +525,7 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
             qstring word;
             qstring line;
             bool refresh = false;
+            vector<size_t> changed;   //lines of the viewer's text showing the renamed item
             if (get_current_word(w, false, word, &line)) {
                string sword(word.c_str());
 //               msg("Try to rename: %s\n", word.c_str());
@@ -241,7 +549,7 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
                               lv->current_name = newname;
                               dec->locals.erase(sword);
                               dec->locals[newname] = lv;
-                              dec->ast->rename(sword, newname);
+                              dec->ast->rename(sword, newname, &changed);
                               refresh = true;
                            }
                            else {
@@ -255,7 +563,7 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
                            lv->current_name = newname;
                            dec->locals.erase(sword);
                            dec->locals[word.c_str()] = lv;
-                           dec->ast->rename(sword, word.c_str());
+                           dec->ast->rename(sword, word.c_str(), &changed);
                            nn.hashset(lv->ghidra_name.c_str(), word.c_str());
                            refresh = true;
                         }
@@ -264,7 +572,10 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
                   else if (do_ida_rename(new_name, dec->ida_func->start_ea) == 2) {
                      //renming a global
                      string snew_name(new_name.c_str());
-                     dec->ast->rename(sword, snew_name);
+                     dec->ast->rename(sword, snew_name, &changed);
+                     //usually already done by the idb hook, unless the decompiler
+                     //showed a name other than IDA's
+                     xrefs.rename(sword, snew_name);
 //                     msg("rename: %s -> %s\n", word.c_str(), new_name.c_str());
                      refresh = true;
                   }
@@ -273,17 +584,38 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
                }
             }
             if (refresh) {
-               vector<string> code;
-               dec->ast->print(&code);
-               strvec_t *sv = new strvec_t();
-               for (vector<string>::iterator si = code.begin(); si != code.end(); si++) {
-                  sv->push_back(simpleline_t(si->c_str()));
+               //only the lines that mention the renamed item need to change
+               FuncText *lines = dec->text;
+               for (vector<size_t>::iterator ci = changed.begin(); ci != changed.end(); ci++) {
+                  if (*ci < lines->size()) {
+                     string text(lines->get_line(*ci));
+                     dec->ast->patch_line(*ci, text);
+                     lines->set_line(*ci, text);
+                  }
                }
-
-               callui(ui_custom_viewer_set_userdata, w, sv);
                refresh_custom_viewer(w);
                repaint_custom_viewer(w);
-               dec->set_ud(sv);
+            }
+            return true;
+         }
+         case 'X': { //list the decompiled functions that use the global under the cursor
+            qstring word;
+            qstring line;
+            if (!get_current_word(w, false, word, &line)) {
+               return false;
+            }
+            map<string, map<uint64_t, vector<int> > >::iterator ri = xrefs.refs.find(word.c_str());
+            if (ri == xrefs.refs.end()) {
+               msg("No decompiled references to %s\n", word.c_str());
+               return true;
+            }
+            msg("References to %s:\n", word.c_str());
+            for (map<uint64_t, vector<int> >::iterator fi = ri->second.begin(); fi != ri->second.end(); fi++) {
+               string fname;
+               get_func_name(fname, fi->first);
+               for (vector<int>::iterator li = fi->second.begin(); li != fi->second.end(); li++) {
+                  msg("   %s (0x%llx) line %d\n", fname.c_str(), (unsigned long long)fi->first, *li + 1);
+               }
             }
             return true;
          }
@@ -302,13 +634,7 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
                int x = -1;
                int y = -1;
 
-               place_t *pl = get_custom_viewer_place(w, false, &x, &y);
-               tcc_place_type_t pt = get_viewer_place_type(w);
-               if (pl && pt == TCCPT_SIMPLELINE_PLACE) {
-                  simpleline_place_t *slp = (simpleline_place_t*)pl;
-                  y = slp->n;
-               }
-               else {
+               if (!get_cursor_line(w, &y, &x)) {
                   msg("Couldn't retrieve line number\n");
                   return false;
                }
@@ -353,6 +679,18 @@ static bool idaapi ct_keyboard(TWidget *w, int key, int shift, void *ud) {
             }
             return true;
          }
+         case IK_TAB: { //show the disassembly for the current line
+            Decompiled *dec = function_map[w];
+            int line;
+            if (!get_cursor_line(w, &line)) {
+               return false;
+            }
+            uint64_t ea;
+            if (dec->ast->find_addr(line, &ea)) {
+               jumpto(ea);
+            }
+            return true;
+         }
          case IK_DIVIDE: { //Add eol comment on current line
             int x, y;
             if (get_custom_viewer_place(w, false, &x, &y) == NULL) {
@@ -467,6 +805,7 @@ int do_ida_rename(qstring &name, ea_t func) {
 }
 
 void init_ida_ghidra() {
+   xrefs.load();
    const char *ghidra = getenv("GHIDRA_DIR");
    if (ghidra) {
       ghidra_dir = ghidra;
@@ -699,6 +1038,90 @@ bool does_func_return(void *func) {
    return func_does_return(f->start_ea);
 }
 
+//name of the item being renamed, captured before IDA changes it so that the
+//global reference index can follow the rename
+static ea_t renaming_ea = BADADDR;
+static qstring renaming_old;
+
+static ssize_t idaapi idp_callback(void *user_data, int code, va_list va) {
+   if (code == processor_t::ev_rename) {
+      renaming_ea = va_arg(va, ea_t);
+      renaming_old.clear();
+      if (get_name(&renaming_old, renaming_ea) <= 0) {
+         renaming_ea = BADADDR;
+      }
+   }
+   return 0;
+}
+
+//forward no-return changes, including functions IDA creates after the plugin loaded,
+//and drop cached analysis and global references made stale by edits in IDA
+static ssize_t idaapi idb_callback(void *user_data, int code, va_list va) {
+   switch (code) {
+      case idb_event::func_added: {
+         func_t *pfn = va_arg(va, func_t *);
+         if (pfn->flags & FUNC_NORET) {
+            update_noreturn(pfn->start_ea, true);
+         }
+         break;
+      }
+      case idb_event::func_noret_changed: {
+         func_t *pfn = va_arg(va, func_t *);
+         update_noreturn(pfn->start_ea, (pfn->flags & FUNC_NORET) != 0);
+         break;
+      }
+      case idb_event::func_updated:
+      case idb_event::deleting_func: {
+         func_t *pfn = va_arg(va, func_t *);
+         invalidate_function(pfn->start_ea);
+         xrefs.invalidate(pfn->start_ea);
+         break;
+      }
+      case idb_event::byte_patched: {
+         ea_t ea = va_arg(va, ea_t);
+         func_t *pfn = get_func(ea);
+         if (pfn != NULL) {
+            invalidate_function(pfn->start_ea);
+            xrefs.invalidate(pfn->start_ea);
+         }
+         invalidate_data(ea);
+         break;
+      }
+      case idb_event::renamed: {
+         ea_t ea = va_arg(va, ea_t);
+         const char *new_name = va_arg(va, const char *);
+         bool local_name = va_arg(va, int) != 0;
+         if (ea == renaming_ea && !local_name && new_name != NULL) {
+            xrefs.rename(renaming_old.c_str(), new_name);
+         }
+         renaming_ea = BADADDR;
+         break;
+      }
+      case idb_event::make_data: {
+         ea_t ea = va_arg(va, ea_t);
+         invalidate_data(ea);
+         break;
+      }
+      case idb_event::sgr_changed:
+      case idb_event::segm_attrs_updated:
+         invalidate_all();
+         break;
+      default:
+         break;
+   }
+   return 0;
+}
+
+void hook_idb_events() {
+   hook_to_notification_point(HT_IDB, idb_callback, NULL);
+   hook_to_notification_point(HT_IDP, idp_callback, NULL);
+}
+
+void unhook_idb_events() {
+   unhook_from_notification_point(HT_IDP, idp_callback, NULL);
+   unhook_from_notification_point(HT_IDB, idb_callback, NULL);
+}
+
 uint64_t get_func_start(void *func) {
    func_t *f = (func_t*)func;
    return f->start_ea;
@@ -788,12 +1211,50 @@ void map_ghidra_to_ida(Decompiled *dec) {
    }
 }
 
+//collect the direct calls made by f to the start of other functions
+static void get_calls_from(func_t *f, vector<CallSite> &calls) {
+   func_item_iterator_t fii;
+   for (bool ok = fii.set(f); ok; ok = fii.next_code()) {
+      ea_t ea = fii.current();
+      xrefblk_t xb;
+      for (bool x = xb.first_from(ea, XREF_FAR); x; x = xb.next_from()) {
+         if (xb.iscode && (xb.type == fl_CN || xb.type == fl_CF)) {
+            func_t *callee = get_func(xb.to);
+            if (callee && callee->start_ea == xb.to) {
+               CallSite cs = {f->start_ea, xb.to, ea};
+               calls.push_back(cs);
+            }
+         }
+      }
+   }
+}
+
+//recover the prototypes of f's direct callees so its call sites need no trial
+//analysis. This is a paramid pass per callee, so it is only done for batch work.
+//Failed recoveries are remembered and not retried
+static void recover_callee_prototypes(func_t *f) {
+   vector<CallSite> calls;
+   get_calls_from(f, calls);
+   for (size_t i = 0; i < calls.size(); i++) {
+      func_t *callee = get_func(calls[i].to);
+      if (callee && callee != f) {
+         try {
+            recover_prototype(callee->start_ea, callee->end_ea);
+         } catch (...) {
+            //the call site falls back to trial analysis, which reports its own errors
+         }
+      }
+   }
+}
+
 void decompile_at(ea_t addr, TWidget *w) {
    string xml;
    string cfunc;
    func_t *func = get_func(addr);
    Function *ast = NULL;
    if (func) {
+      //interactive opens only consult the prototypes already in the cache
+      new_analysis_pass();
       int res = do_decompile(func->start_ea, func->end_ea, &ast);
       if (ast) {
 //         msg("got a Functon tree!\n");
@@ -803,16 +1264,15 @@ void decompile_at(ea_t addr, TWidget *w) {
 //         msg("mapping ida names to ghidra names\n");
          map_ghidra_to_ida(dec);
 
-         vector<string> code;
 //         msg("Generating C code\n");
-         dec->ast->print(&code);
+         FuncText *ft = new FuncText(ast->render_bytes, ast->render_lines);
+         dec->text = ft;
+         dec->ast->print(ft->rc);
+         xrefs.update(func->start_ea, dec->ast->globals);
 
 //         msg("Displaying C code\n");
-         strvec_t *sv = new strvec_t();
-         dec->set_ud(sv);
-         for (vector<string>::iterator si = code.begin(); si != code.end(); si++) {
-            sv->push_back(simpleline_t(si->c_str()));
-         }
+         //the viewer reads its lines straight out of the retained render buffer
+         func_place_t::register_class();
 
          qstring func_name;
          qstring fmt;
@@ -820,12 +1280,12 @@ void decompile_at(ea_t addr, TWidget *w) {
          string title = get_available_title();
          fmt.sprnt("Ghidra code  - %s", title.c_str());   // make the suffix change with more windows
 
-         simpleline_place_t s1;
-         simpleline_place_t s2((int)(sv->size() - 1));
+         func_place_t s1;
+         func_place_t s2(ft->size() == 0 ? 0 : ft->size() - 1);
 
          if (w == NULL) {
             w = create_custom_viewer(fmt.c_str(), &s1, &s2,
-                                     &s1, NULL, sv, &handlers, sv);
+                                     &s1, NULL, ft, &handlers, ft);
             TWidget *code_view = create_code_viewer(w);
             set_code_viewer_is_source(code_view);
             display_widget(code_view, WOPN_DP_TAB);
@@ -834,12 +1294,25 @@ void decompile_at(ea_t addr, TWidget *w) {
             titles.insert(title);
          }
          else {
-            callui(ui_custom_viewer_set_userdata, w, sv);
+            callui(ui_custom_viewer_set_userdata, w, ft);
+            set_custom_viewer_range(w, &s1, &s2);
             refresh_custom_viewer(w);
             repaint_custom_viewer(w);
             delete function_map[w];
          }
          function_map[w] = dec;
+
+         //put the cursor on the statement for the address we were asked about
+         int line;
+         int col;
+         if (addr != func->start_ea && dec->ast->find_line(addr, &line, &col) && line < (int)ft->size()) {
+            string text = ft->get_line(line);
+            for (const char *cptr = text.c_str(); *cptr == ' '; cptr++) {
+               col++;
+            }
+            func_place_t pl(line);
+            jumpto(w, &pl, col, 0);
+         }
       }
 //      msg("do_decompile returned: %d\n%s\n%s\n", res, code.c_str(), cfunc.c_str());
    }
@@ -851,7 +1324,240 @@ const char *tag_remove(const char *tagged) {
    return ll.c_str();
 }
 
-bool idaapi blc_run(size_t /*arg*/) {
+//collect every function and the direct calls between them from IDA's xrefs
+static void get_call_graph(vector<uint64_t> &funcs, vector<CallSite> &calls) {
+   size_t nfuncs = get_func_qty();
+   for (size_t i = 0; i < nfuncs; i++) {
+      func_t *f = getn_func(i);
+      if (f == NULL) {
+         continue;
+      }
+      funcs.push_back(f->start_ea);
+      get_calls_from(f, calls);
+   }
+}
+
+//decompile every function once so that the global reference index is complete.
+//Callees are decompiled before their callers
+static void index_all_functions() {
+   vector<uint64_t> funcs;
+   vector<CallSite> calls;
+   vector<vector<uint64_t> > batches;
+   new_analysis_pass();
+   show_wait_box("Building call graph");
+   get_call_graph(funcs, calls);
+   schedule_bottom_up(funcs, calls, batches);
+
+   size_t done = 0;
+   for (size_t b = 0; b < batches.size(); b++) {
+      vector<uint64_t> &batch = batches[b];
+      for (size_t i = 0; i < batch.size(); i++, done++) {
+         if (user_cancelled()) {
+            hide_wait_box();
+            return;
+         }
+         replace_wait_box("Indexing global references (%u/%u)", (uint32_t)done, (uint32_t)funcs.size());
+         func_t *f = get_func(batch[i]);
+         if (f == NULL) {
+            continue;
+         }
+         Function *ast = NULL;
+         do_decompile(f->start_ea, f->end_ea, &ast);
+         if (ast) {
+            ast->print((vector<string>*)NULL);
+            xrefs.update(f->start_ea, ast->globals);
+            delete ast;
+         }
+         else {
+            xrefs.invalidate(f->start_ea);
+         }
+      }
+   }
+   hide_wait_box();
+}
+
+//an export records its progress in <file>.ckpt: the start address of the last
+//function written and the size of the output file at that point
+static bool read_export_checkpoint(const string &ckpt, uint64_t &last, uint64_t &size) {
+   ifstream in(ckpt.c_str());
+   return (bool)(in >> std::hex >> last >> std::dec >> size);
+}
+
+static void write_export_checkpoint(const string &ckpt, uint64_t last, uint64_t size) {
+   std::ofstream out(ckpt.c_str(), std::ios::out | std::ios::trunc);
+   out << std::hex << last << ' ' << std::dec << size << std::endl;
+}
+
+//drop anything written after the last checkpoint
+static bool truncate_export(const string &path, uint64_t size) {
+#if defined(__NT__)
+   int fh = _open(path.c_str(), _O_RDWR | _O_BINARY);
+   if (fh < 0) {
+      return false;
+   }
+   bool ok = _chsize_s(fh, size) == 0;
+   _close(fh);
+   return ok;
+#else
+   return truncate(path.c_str(), (off_t)size) == 0;
+#endif
+}
+
+//decompile the functions that start in the selected range (or every function) and
+//exports started in this session. The types recovered for them are still known,
+//so a resume of one of them can still write a complete header
+static set<string> exported_paths;
+
+//stream the C straight to a file. Types and globals go to a header written once the
+//functions are done, since most of them are only recovered while decompiling
+static void export_functions() {
+   const char *file = ask_file(true, "*.c", "Export decompiled C to");
+   if (file == NULL) {
+      return;
+   }
+   string path(file);
+   string ckpt = path + ".ckpt";
+   string hpath = path;
+   if (hpath.size() > 2 && hpath.compare(hpath.size() - 2, 2, ".c") == 0) {
+      hpath.erase(hpath.size() - 2);
+   }
+   hpath += ".h";
+
+   ea_t sel_start = 0;
+   ea_t sel_end = BADADDR;
+   if (!read_range_selection(NULL, &sel_start, &sel_end)) {
+      sel_start = 0;
+      sel_end = BADADDR;
+   }
+   vector<uint64_t> funcs;
+   size_t nfuncs = get_func_qty();
+   for (size_t i = 0; i < nfuncs; i++) {
+      func_t *f = getn_func(i);
+      if (f && f->start_ea >= sel_start && f->start_ea < sel_end) {
+         funcs.push_back(f->start_ea);
+      }
+   }
+
+   uint64_t last = 0;
+   uint64_t offset = 0;
+   bool resume = false;
+   if (read_export_checkpoint(ckpt, last, offset)) {
+      resume = ask_yn(ASKBTN_YES, "Resume the interrupted export to %s?", path.c_str()) == ASKBTN_YES;
+      if (resume && !truncate_export(path, offset)) {
+         warning("Unable to resume the export to %s", path.c_str());
+         return;
+      }
+   }
+
+   //the printer makes many small writes, give the stream a large buffer
+   vector<char> buf(4 * 1024 * 1024);
+   std::ofstream out;
+   out.rdbuf()->pubsetbuf(&buf[0], buf.size());
+   std::ios::openmode mode = std::ios::out | std::ios::binary;
+   out.open(path.c_str(), mode | (resume ? std::ios::app : std::ios::trunc));
+   if (!out) {
+      warning("Unable to open %s", path.c_str());
+      return;
+   }
+
+   //a resume in a new session only knows the types recovered since it was resumed
+   bool partial = resume && exported_paths.find(path) == exported_paths.end();
+   exported_paths.insert(path);
+
+   new_analysis_pass();
+   show_wait_box("Exporting decompiled C");
+   if (!resume) {
+      out << "#include \"" << qbasename(hpath.c_str()) << "\"\n\n";
+      offset = 0;
+   }
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   uint64_t size = offset;
+   double secs = 0;
+   size_t done = 0;
+   size_t failed = 0;
+   bool cancelled = false;
+   for (size_t i = 0; i < funcs.size(); i++) {
+      if (resume && funcs[i] <= last) {
+         continue;
+      }
+      if (user_cancelled()) {
+         cancelled = true;
+         break;
+      }
+      func_t *f = get_func(funcs[i]);
+      if (f == NULL) {
+         continue;
+      }
+      //functions are exported in address order, so callees are usually not done yet
+      recover_callee_prototypes(f);
+      if (export_function(f->start_ea, f->end_ea, out) < 0) {
+         failed++;
+      }
+      out << '\n';
+      last = f->start_ea;
+      done++;
+      if ((done % 32) == 0) {
+         out.flush();
+         size = (uint64_t)out.tellp();
+         write_export_checkpoint(ckpt, last, size);
+      }
+      secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      if (secs > 0) {
+         replace_wait_box("Exporting decompiled C (%u/%u)\n%.1f functions/s, %.2f MB/s",
+                          (uint32_t)(i + 1), (uint32_t)funcs.size(), done / secs,
+                          (size - offset) / secs / (1024 * 1024));
+      }
+   }
+   out.flush();
+   size = (uint64_t)out.tellp();
+   out.close();
+
+   std::ofstream hout(hpath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+   if (hout) {
+      if (partial) {
+         hout << "/* PARTIAL: this export was resumed in a new session. Types and globals used\n"
+                 "   only by functions exported before the resume may be missing, export\n"
+                 "   again without resuming for a complete header */\n\n";
+      }
+      export_header(hout);
+   }
+   else {
+      warning("Unable to open %s", hpath.c_str());
+   }
+   hide_wait_box();
+
+   secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   if (secs <= 0) {
+      secs = 1e-3;
+   }
+   msg("blc: exported %u functions (%u failed) to %s in %.1fs, %.1f functions/s, %.2f MB/s\n",
+       (uint32_t)done, (uint32_t)failed, path.c_str(), secs, done / secs,
+       (size - offset) / secs / (1024 * 1024));
+   if (partial) {
+      msg("blc: %s is partial, it only has the types recovered since the export was resumed\n",
+          hpath.c_str());
+   }
+   if (cancelled) {
+      write_export_checkpoint(ckpt, last, size);
+      msg("blc: export interrupted, export to the same file again to resume\n");
+   }
+   else {
+      qunlink(ckpt.c_str());
+   }
+}
+
+//arg 1 runs the batch pre-pass that indexes global references in every function
+//arg 2 exports the decompiled C of the selected (or all) functions to a file
+bool idaapi blc_run(size_t arg) {
+   if (arg == 1) {
+      index_all_functions();
+      return true;
+   }
+   if (arg == 2) {
+      export_functions();
+      return true;
+   }
    ea_t addr = get_screen_ea();
    decompile_at(addr);
    return true;
@@ -67,6 +67,39 @@ uint64_t get_func_end(uint64_t ea);
 
 int do_decompile(uint64_t start_ea, uint64_t end_ea, Function **ast);
 
+//run the cheaper parameter recovery pass on a function that has no cached prototype,
+//so that decompiling its callers can reuse the result
+int recover_prototype(uint64_t start_ea, uint64_t end_ea);
+
+//keep the decompiler's no-return flags in step with IDA's analysis after the initial bulk import
+void update_noreturn(uint64_t ea, bool noreturn);
+//drop cached analysis made stale by edits in IDA: code or flow in the function at ea,
+//data bytes at ea, or anything (segment registers and segment attributes)
+void invalidate_function(uint64_t ea);
+void invalidate_data(uint64_t ea);
+void invalidate_all();
+//start a new decompile or batch. Cached prototypes are checked against the bytes of
+//their function at most once per pass
+void new_analysis_pass();
+void hook_idb_events();
+void unhook_idb_events();
+
+//streaming C export. Each function is decompiled, printed straight to out and its analysis
+//released, then the header (types and globals recovered along the way) is printed once
+void export_header(ostream &out);
+int export_function(uint64_t start_ea, uint64_t end_ea, ostream &out);
+
+struct CallSite {
+   uint64_t from;    //calling function
+   uint64_t to;      //called function
+   uint64_t site;    //address of the call instruction
+};
+
+//order funcs callees first. Functions in the same batch do not call each other,
+//and every callee outside a function's own recursion cycle is in an earlier batch
+void schedule_bottom_up(const vector<uint64_t> &funcs, const vector<CallSite> &calls,
+                        vector<vector<uint64_t> > &batches);
+
 const char *tag_remove(const char *tagged);
 
 bool is_thumb_mode(uint64_t ea);
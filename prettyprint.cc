@@ -397,34 +397,34 @@ void TokenSplit::print(EmitXml *emit) const
     emit->endFuncProto(count);
     break;
   case vari_t:	// tagVariable
-    emit->tagVariable(tok.c_str(),hl,ptr_second.vn,op);
+    emit->tagVariable(tok,hl,ptr_second.vn,op);
     break;
   case op_t:		// tagOp
-    emit->tagOp(tok.c_str(),hl,op);
+    emit->tagOp(tok,hl,op);
     break;
   case fnam_t:	// tagFuncName
-    emit->tagFuncName(tok.c_str(),hl,ptr_second.fd,op);
+    emit->tagFuncName(tok,hl,ptr_second.fd,op);
     break;
   case type_t:	// tagType
-    emit->tagType(tok.c_str(),hl,ptr_second.ct);
+    emit->tagType(tok,hl,ptr_second.ct);
     break;
   case field_t: // tagField
-    emit->tagField(tok.c_str(),hl,ptr_second.ct,(int4)off);
+    emit->tagField(tok,hl,ptr_second.ct,(int4)off);
     break;
   case comm_t:	// tagComment
-    emit->tagComment(tok.c_str(),hl,ptr_second.spc,off);
+    emit->tagComment(tok,hl,ptr_second.spc,off);
     break;
   case label_t:	// tagLabel
-    emit->tagLabel(tok.c_str(),hl,ptr_second.spc,off);
+    emit->tagLabel(tok,hl,ptr_second.spc,off);
     break;
   case synt_t:	// print
-    emit->print(tok.c_str(),hl);
+    emit->print(tok,hl);
     break;
   case opar_t:	// openParen
-    emit->openParen(tok[0],count);
+    emit->openParen(paren,count);
     break;
   case cpar_t:	// closeParen
-    emit->closeParen(tok[0],count);
+    emit->closeParen(paren,count);
     break;
   case oinv_t:	// Invisible open
     break;
@@ -536,6 +536,39 @@ void TokenSplit::printDebug(ostream &s) const
 }
 #endif
 
+TokenArena::~TokenArena(void)
+
+{
+  for(int4 i=0;i<blocks.size();++i)
+    delete [] blocks[i];
+}
+
+/// The string is copied, including its terminator, into the first block (starting with the
+/// current one) that has room for it. A new block is allocated if none do.
+/// \param str is the null-terminated string to copy
+/// \param len passes back the number of characters in the string (excluding the terminator)
+/// \return the copy, which remains valid until the next reset()
+const char *TokenArena::save(const char *str,int4 &len)
+
+{
+  len = strlen(str);
+  int4 need = len + 1;
+  while(cur < blocks.size() && blocksize[cur] - used < need) {
+    cur += 1;
+    used = 0;
+  }
+  if (cur == blocks.size()) {
+    int4 sz = (need > 4096) ? need : 4096;
+    blocks.push_back(new char[sz]);
+    blocksize.push_back(sz);
+    used = 0;
+  }
+  char *res = blocks[cur] + used;
+  memcpy(res,str,need);
+  used += need;
+  return res;
+}
+
 EmitPrettyPrint::EmitPrettyPrint(int4 mls) 
   : EmitXml(), scanqueue( 3*mls ), tokqueue( 3*mls )
 
@@ -559,12 +592,13 @@ EmitPrettyPrint::~EmitPrettyPrint(void)
 /// quickly reach a size that supports the biggest possible number of cached tokens.
 /// The current token queue is preserved and references into the queue are
 /// recalculated.
-void EmitPrettyPrint::expand(void)
+/// \param amount is the number of additional tokens the queue will support
+void EmitPrettyPrint::expand(int4 amount)
 
 {
   int4 max = tokqueue.getMax();
   int4 left = tokqueue.bottomref();
-  tokqueue.expand(200);
+  tokqueue.expand(amount);
   // Expanding puts the leftmost element at reference 0
   // So we need to adjust references
   for(int4 i=0;i<max;++i)
@@ -573,7 +607,7 @@ void EmitPrettyPrint::expand(void)
   // or equal to the number of elements in tokqueue, so
   // if we keep scanqueue and tokqueue with the same max
   // we don't need to check for scanqueue overflow
-  scanqueue.expand(200);
+  scanqueue.expand(amount);
 }
 
 /// (Permanently) adjust the current set of indent levels to guarantee a minimum
@@ -713,7 +747,10 @@ void EmitPrettyPrint::advanceleft(void)
       break;
     }
     tokqueue.popbottom();
-    if (tokqueue.empty()) break;
+    if (tokqueue.empty()) {
+      arena.reset();		// No token refers to the arena any longer
+      break;
+    }
     l = tokqueue.bottom().getSize();
   }
 }
@@ -730,7 +767,7 @@ void EmitPrettyPrint::scan(void)
 
 {
   if (tokqueue.empty())		// If we managed to overflow queue
-    expand();			// Expand it
+    expand(200);		// Expand it
   // Delay creating reference until after the possible expansion
   TokenSplit &tok( tokqueue.top() );
   switch(tok.getClass()) {
@@ -823,7 +860,7 @@ void EmitPrettyPrint::checkend(void)
 {
   if (!needbreak) {
     TokenSplit &tok( tokqueue.push() );
-    tok.print("",EmitXml::no_color); // Add a blank string
+    tok.print("",0,EmitXml::no_color); // Add a blank string
     scan();
   }
   needbreak = true;
@@ -837,7 +874,7 @@ void EmitPrettyPrint::checkbreak(void)
 {
   if (!needbreak) {
     TokenSplit &tok( tokqueue.push() );
-    tok.print("",EmitXml::no_color); // Add a blank string
+    tok.print("",0,EmitXml::no_color); // Add a blank string
     scan();
   }
   needbreak = false;
@@ -869,6 +906,21 @@ int4 EmitPrettyPrint::beginFunction(const Funcdata *fd)
   if (!tokqueue.empty())
     throw LowlevelError("Starting with non-empty token queue");
 #endif
+  if (tokqueue.empty() && fd != (const Funcdata *)0) {
+    // Size the queue up front from the number of operations, so that large functions
+    // do not grow it repeatedly. Only uncommitted tokens are queued, so cap the size.
+    int4 numops = 0;
+    list<PcodeOp *>::const_iterator iter;
+    for(iter=fd->beginOpAlive();iter!=fd->endOpAlive();++iter)
+      numops += 1;
+    int4 want = 4*numops;
+    if (want > 64*maxlinesize)
+      want = 64*maxlinesize;
+    if (want > tokqueue.getMax()) {
+      tokqueue.setMax(want);
+      scanqueue.setMax(want);
+    }
+  }
   checkstart();
   TokenSplit &tok( tokqueue.push() );
   int4 id = tok.beginFunction(fd);
@@ -1000,8 +1052,10 @@ void EmitPrettyPrint::tagVariable(const char *ptr,syntax_highlight hl,
 				    const Varnode *vn,const PcodeOp *op)
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagVariable(ptr,hl,vn,op);
+  tok.tagVariable(content,len,hl,vn,op);
   scan();
 }
 
@@ -1009,8 +1063,10 @@ void EmitPrettyPrint::tagOp(const char *ptr,syntax_highlight hl,const PcodeOp *o
 
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagOp(ptr,hl,op);
+  tok.tagOp(content,len,hl,op);
   scan();
 }
 
@@ -1018,8 +1074,10 @@ void EmitPrettyPrint::tagFuncName(const char *ptr,syntax_highlight hl,const Func
 
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagFuncName(ptr,hl,fd,op);
+  tok.tagFuncName(content,len,hl,fd,op);
   scan();
 }
 
@@ -1027,8 +1085,10 @@ void EmitPrettyPrint::tagType(const char *ptr,syntax_highlight hl,const Datatype
 
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagType(ptr,hl,ct);
+  tok.tagType(content,len,hl,ct);
   scan();
 }
 
@@ -1036,8 +1096,10 @@ void EmitPrettyPrint::tagField(const char *ptr,syntax_highlight hl,const Datatyp
 
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagField(ptr,hl,ct,o);
+  tok.tagField(content,len,hl,ct,o);
   scan();
 }
 
@@ -1045,8 +1107,10 @@ void EmitPrettyPrint::tagComment(const char *ptr,syntax_highlight hl,
 				   const AddrSpace *spc,uintb off)
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagComment(ptr,hl,spc,off);
+  tok.tagComment(content,len,hl,spc,off);
   scan();
 }
 
@@ -1054,8 +1118,10 @@ void EmitPrettyPrint::tagLabel(const char *ptr,syntax_highlight hl,
 				 const AddrSpace *spc,uintb off)
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(ptr,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.tagLabel(ptr,hl,spc,off);
+  tok.tagLabel(content,len,hl,spc,off);
   scan();
 }
 
@@ -1063,8 +1129,10 @@ void EmitPrettyPrint::print(const char *str,syntax_highlight hl)
 
 {
   checkstring();
+  int4 len;
+  const char *content = arena.save(str,len);
   TokenSplit &tok( tokqueue.push() );
-  tok.print(str,hl);
+  tok.print(content,len,hl);
   scan();
 }
 
@@ -1135,6 +1203,7 @@ void EmitPrettyPrint::clear(void)
   indentstack.clear();
   scanqueue.clear();
   tokqueue.clear();
+  arena.reset();
   leftotal = 1;
   rightotal = 1;
   needbreak = false;
@@ -1177,6 +1246,7 @@ void EmitPrettyPrint::flush(void)
       throw LowlevelError("Cannot flush pretty printer. Missing group end");
     print(tok);
   }
+  arena.reset();
   needbreak = false;
 #ifdef PRETTY_DEBUG
   if (!scanqueue.empty())
@@ -325,7 +325,8 @@ public:
 private:
   tag_type tagtype;		///< Type of token
   printclass delimtype;		///< The general class of the token
-  string tok;			///< Characters of token (if any)
+  const char *tok;		///< Characters of token (if any), owned by the emitter's TokenArena
+  char paren;			///< Parenthesis character (for \e opar_t and \e cpar_t tokens)
   EmitXml::syntax_highlight hl;	///< Highlighting for token
   // Additional markup elements for token
   const PcodeOp *op;		///< Pcode-op associated with \b this token
@@ -437,80 +438,88 @@ public:
   /// \brief Create a variable identifier token
   ///
   /// \param ptr is the character data for the identifier
+  /// \param sz is the number of characters in the identifier
   /// \param h indicates how the identifier should be highlighted
   /// \param v is the Varnode representing the variable within the syntax tree
   /// \param o is a p-code operation related to the use of the variable (may be null)
-  void tagVariable(const char *ptr,EmitXml::syntax_highlight h,
+  void tagVariable(const char *ptr,int4 sz,EmitXml::syntax_highlight h,
 		    const Varnode *v,const PcodeOp *o) {
-    tok = ptr; size = tok.size();
+    tok = ptr; size = sz;
     tagtype=vari_t; delimtype=tokenstring; hl=h; ptr_second.vn=v; op=o; }
 
   /// \brief Create an operator token
   ///
   /// \param ptr is the character data for the emitted representation
+  /// \param sz is the number of characters in the representation
   /// \param h indicates how the token should be highlighted
   /// \param o is the PcodeOp object associated with the operation with the syntax tree
-  void tagOp(const char *ptr,EmitXml::syntax_highlight h,const PcodeOp *o) {
-    tok = ptr; size = tok.size();
+  void tagOp(const char *ptr,int4 sz,EmitXml::syntax_highlight h,const PcodeOp *o) {
+    tok = ptr; size = sz;
     tagtype=op_t; delimtype=tokenstring; hl=h; op=o; }
 
   /// \brief Create a function identifier token
   ///
   /// \param ptr is the character data for the identifier
+  /// \param sz is the number of characters in the identifier
   /// \param h indicates how the identifier should be highlighted
   /// \param f is the function
   /// \param o is the CALL operation associated within the syntax tree or null for a declaration
-  void tagFuncName(const char *ptr,EmitXml::syntax_highlight h,const Funcdata *f,const PcodeOp *o) {
-    tok = ptr; size = tok.size();
+  void tagFuncName(const char *ptr,int4 sz,EmitXml::syntax_highlight h,const Funcdata *f,const PcodeOp *o) {
+    tok = ptr; size = sz;
     tagtype=fnam_t; delimtype=tokenstring; hl=h; ptr_second.fd=f; op=o; }
 
   /// \brief Create a data-type identifier token
   ///
   /// \param ptr is the character data for the identifier
+  /// \param sz is the number of characters in the identifier
   /// \param h indicates how the identifier should be highlighted
   /// \param ct is the data-type description object
-  void tagType(const char *ptr,EmitXml::syntax_highlight h,const Datatype *ct) {
-    tok = ptr; size = tok.size();
+  void tagType(const char *ptr,int4 sz,EmitXml::syntax_highlight h,const Datatype *ct) {
+    tok = ptr; size = sz;
     tagtype=type_t; delimtype=tokenstring; hl=h; ptr_second.ct=ct; }
 
   /// \brief Create an identifier for a field within a structured data-type
   ///
   /// \param ptr is the character data for the identifier
+  /// \param sz is the number of characters in the identifier
   /// \param h indicates how the identifier should be highlighted
   /// \param ct is the data-type associated with the field
   /// \param o is the (byte) offset of the field within its structured data-type
-  void tagField(const char *ptr,EmitXml::syntax_highlight h,const Datatype *ct,int4 o) {
-    tok = ptr; size = tok.size();
+  void tagField(const char *ptr,int4 sz,EmitXml::syntax_highlight h,const Datatype *ct,int4 o) {
+    tok = ptr; size = sz;
     tagtype=field_t; delimtype=tokenstring; hl=h; ptr_second.ct=ct; off=(uintb)o; }
 
   /// \brief Create a comment string in the generated source code
   ///
   /// \param ptr is the character data for the comment
+  /// \param sz is the number of characters in the comment
   /// \param h indicates how the comment should be highlighted
   /// \param s is the address space of the address where the comment is attached
   /// \param o is the offset of the address where the comment is attached
-  void tagComment(const char *ptr,EmitXml::syntax_highlight h,
+  void tagComment(const char *ptr,int4 sz,EmitXml::syntax_highlight h,
 		   const AddrSpace *s,uintb o) {
-    tok = ptr; size = tok.size(); ptr_second.spc=s; off=o;
+    tok = ptr; size = sz; ptr_second.spc=s; off=o;
     tagtype=comm_t; delimtype=tokenstring; hl=h; }
 
   /// \brief Create a code label identifier token
   ///
   /// \param ptr is the character data of the label
+  /// \param sz is the number of characters in the label
   /// \param h indicates how the label should be highlighted
   /// \param s is the address space of the code address being labeled
   /// \param o is the offset of the code address being labeled
-  void tagLabel(const char *ptr,EmitXml::syntax_highlight h,
+  void tagLabel(const char *ptr,int4 sz,EmitXml::syntax_highlight h,
 		 const AddrSpace *s,uintb o) {
-    tok = ptr; size = tok.size(); ptr_second.spc=s; off=o;
+    tok = ptr; size = sz; ptr_second.spc=s; off=o;
     tagtype=label_t; delimtype=tokenstring; hl=h; }
 
   /// \brief Create a token for other (more unusual) syntax in source code
   ///
   /// \param str is the character data of the syntax being emitted
+  /// \param sz is the number of characters in the syntax
   /// \param h indicates how the syntax should be highlighted
-  void print(const char *str,EmitXml::syntax_highlight h) {
-    tok = str; size=tok.size();
+  void print(const char *str,int4 sz,EmitXml::syntax_highlight h) {
+    tok = str; size=sz;
     tagtype=synt_t; delimtype=tokenstring; hl=h; }
 
   /// \brief Create an open parenthesis
@@ -518,7 +527,7 @@ public:
   /// \param o is the open parenthesis character to emit
   /// \param id is an id to associate with the parenthesis
   void openParen(char o,int4 id) {
-    tok = o; size = 1;
+    paren = o; size = 1;
     tagtype=opar_t; delimtype=tokenstring; count=id; }
 
   /// \brief Create a close parenthesis
@@ -526,7 +535,7 @@ public:
   /// \param c is the close parenthesis character to emit
   /// \param id is the id associated with the matching open parenthesis (as returned by openParen)
   void closeParen(char c,int4 id) {
-    tok = c; size = 1;
+    paren = c; size = 1;
     tagtype=cpar_t; delimtype=tokenstring; count=id; }
 
   /// \brief Create a "start a printing group" command
@@ -684,6 +693,24 @@ void circularqueue<_type>::expand(int4 amount)
   max += amount; 
 }
 
+/// \brief Character storage for the content of queued tokens
+///
+/// Content passed to the pretty printer is copied once into large blocks, and each TokenSplit
+/// refers to its characters by pointer. This keeps TokenSplit free of owned strings, so the
+/// token queue can be expanded by plain copies. Blocks are never moved or freed while tokens
+/// are queued; all storage is recycled at once when the queue drains.
+class TokenArena {
+  vector<char *> blocks;	///< Allocated blocks, in order of use
+  vector<int4> blocksize;	///< Capacity of each block
+  int4 cur;			///< Index of the block currently being filled
+  int4 used;			///< Number of bytes used in the current block
+public:
+  TokenArena(void) { cur = 0; used = 0; }	///< Constructor
+  ~TokenArena(void);				///< Destructor
+  const char *save(const char *str,int4 &len);	///< Copy a null-terminated string into the arena
+  void reset(void) { cur = 0; used = 0; }	///< Recycle all storage
+};
+
 /// \brief A generic source code pretty printer
 ///
 /// This pretty printer is based on the standard Derek C. Oppen pretty printing
@@ -712,7 +739,8 @@ class EmitPrettyPrint : public EmitXml {
   string commentfill;		///< Used to fill comments if line breaks are forced
   circularqueue<int4> scanqueue; ///< References to current \e open and \e whitespace tokens
   circularqueue<TokenSplit> tokqueue;	///< The full stream of tokens
-  void expand(void);		///< Expand the stream buffer
+  TokenArena arena;		///< Storage for the content of tokens in \b tokqueue
+  void expand(int4 amount);	///< Expand the stream buffer
   void checkstart(void);	///< Enforce whitespace for a \e start token
   void checkend(void);		///< Enforce whitespace for an \e end token
   void checkstring(void);	///< Enforce whitespace for a \e content token
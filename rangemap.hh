@@ -19,8 +19,11 @@
 #ifndef __RANGEMAP__
 #define __RANGEMAP__
 
+#include "types.h"
 #include <set>
 #include <list>
+#include <vector>
+#include <algorithm>
 
 /// \brief An interval map container
 ///
@@ -61,6 +64,13 @@
 /// distinct \b recordtype that overlaps that sub-range.  The sub-range multiset is updated
 /// with every insertion or deletion of \b recordtype objects into the container, which
 /// may insert new or delete existing boundary points separating the disjoint subranges.
+///
+/// Queries are answered from the multiset until the container has been queried enough times
+/// without modification, at which point a flat index (the sub-range end points in a sorted array,
+/// in parallel with iterators into the multiset) is compiled and used instead.  Any insertion or
+/// deletion drops the index, so containers that are built once and then queried constantly,
+/// like a large global scope, get contiguous binary searches, while containers that are
+/// modified between queries keep using the tree.  Results are identical either way.
 template<typename _recordtype>
 class rangemap {
 public:
@@ -127,12 +137,23 @@ public:
 private:
   std::multiset<AddrRange> tree;	///< The underlying multiset of sub-ranges
   std::list<_recordtype> record;	///< Storage for the actual record objects
+  mutable std::vector<linetype> flatlast;	///< End point of each sub-range, in \b tree order
+  mutable std::vector<typename std::multiset<AddrRange>::const_iterator> flatpart;	///< Each sub-range, in \b tree order
+  mutable bool flatvalid;		///< \b true if the flat index matches \b tree
+  mutable uint4 querycount;		///< Number of queries since the last modification
 
   void zip(linetype i,typename std::multiset<AddrRange>::iterator iter);	///< Remove the given partition boundary
   void unzip(linetype i,typename std::multiset<AddrRange>::iterator iter);	///< Insert the given partition boundary
+  void invalidateFlat(void) { flatvalid = false; querycount = 0; }	///< Drop the flat index after a modification
+  bool useFlat(void) const;		///< Decide if a query should use the flat index, compiling it if necessary
+  typename std::multiset<AddrRange>::const_iterator flatIter(uint4 i) const {
+    return (i < flatpart.size()) ? flatpart[i] : tree.end(); }	///< Multiset iterator for a flat index position
+  uint4 flatLowerBound(linetype point,const subsorttype &sub) const;	///< Flat index version of tree.lower_bound
+  uint4 flatUpperBound(linetype point,const subsorttype &sub) const;	///< Flat index version of tree.upper_bound
 public:
+  rangemap(void) { flatvalid = false; querycount = 0; }	///< Constructor
   bool empty(void) const { return record.empty(); }		///< Return \b true if the container is empty
-  void clear(void) { tree.clear(); record.clear(); }		///< Clear all records from the container
+  void clear(void) { tree.clear(); record.clear(); flatlast.clear(); flatpart.clear(); invalidateFlat(); }	///< Clear all records from the container
   typename std::list<_recordtype>::const_iterator begin_list(void) const { return record.begin(); }	///< Beginning of records
   typename std::list<_recordtype>::const_iterator end_list(void) const { return record.end(); }	///< End of records
   typename std::list<_recordtype>::iterator begin_list(void) { return record.begin(); }	///< Beginning of records
@@ -222,6 +243,7 @@ typename std::list<_recordtype>::iterator
 rangemap<_recordtype>::insert(const inittype &data,linetype a,linetype b)
 
 {
+  invalidateFlat();
   linetype f=a;
   typename std::list<_recordtype>::iterator liter;
   typename std::multiset<AddrRange>::iterator low = tree.lower_bound(AddrRange(f));
@@ -281,6 +303,7 @@ template<typename _recordtype>
 void rangemap<_recordtype>::erase(typename std::list<_recordtype>::iterator v)
 
 {
+  invalidateFlat();
   linetype a = (*v).getFirst();
   linetype b = (*v).getLast();
   bool leftsew = true;
@@ -325,6 +348,59 @@ void rangemap<_recordtype>::erase(typename std::list<_recordtype>::iterator v)
   record.erase(v);
 }
 
+/// The flat index is compiled once the number of queries since the last modification
+/// reaches a threshold proportional to the number of sub-ranges, so the O(n) compile is
+/// paid for by the queries that follow it.
+/// \return \b true if the flat index is valid and should be used
+template<typename _recordtype>
+bool rangemap<_recordtype>::useFlat(void) const
+
+{
+  if (flatvalid) return true;
+  querycount += 1;
+  if (querycount < 16 + (tree.size() >> 4)) return false;
+  flatlast.clear();
+  flatpart.clear();
+  flatlast.reserve(tree.size());
+  flatpart.reserve(tree.size());
+  typename std::multiset<AddrRange>::const_iterator iter;
+  for(iter=tree.begin();iter!=tree.end();++iter) {
+    flatlast.push_back((*iter).last);
+    flatpart.push_back(iter);
+  }
+  flatvalid = true;
+  return true;
+}
+
+/// Sub-ranges sharing an end point overlap exactly, so after the binary search on end points
+/// only the (short) run of sub-ranges ending at the same point needs a \e subsort comparison.
+/// \param point is the end point to search for
+/// \param sub is the subsort to search for
+/// \return the index of the first sub-range not less than (point,sub)
+template<typename _recordtype>
+uint4 rangemap<_recordtype>::flatLowerBound(linetype point,const subsorttype &sub) const
+
+{
+  uint4 i = std::lower_bound(flatlast.begin(),flatlast.end(),point) - flatlast.begin();
+  while(i < flatlast.size() && flatlast[i] == point && (*flatpart[i]).subsort < sub)
+    i += 1;
+  return i;
+}
+
+/// \param point is the end point to search for
+/// \param sub is the subsort to search for
+/// \return the index of the first sub-range greater than (point,sub)
+template<typename _recordtype>
+uint4 rangemap<_recordtype>::flatUpperBound(linetype point,const subsorttype &sub) const
+
+{
+  subsorttype key(sub);		// Some subsort types only have a non-const comparison
+  uint4 i = std::lower_bound(flatlast.begin(),flatlast.end(),point) - flatlast.begin();
+  while(i < flatlast.size() && flatlast[i] == point && !(key < (*flatpart[i]).subsort))
+    i += 1;
+  return i;
+}
+
 /// \param point is the given boundary point
 /// \return begin/end iterators over all intersecting sub-ranges
 template<typename _recordtype>
@@ -332,6 +408,13 @@ std::pair<typename rangemap<_recordtype>::const_iterator,typename rangemap<_reco
 rangemap<_recordtype>::find(linetype point) const
 
 {
+  if (useFlat()) {
+    uint4 i = std::lower_bound(flatlast.begin(),flatlast.end(),point) - flatlast.begin();
+    if ((i==flatlast.size())||(point < (*flatpart[i]).first))
+      return std::pair<PartIterator,PartIterator>(PartIterator(flatIter(i)),PartIterator(flatIter(i)));
+    uint4 j = std::upper_bound(flatlast.begin()+i,flatlast.end(),flatlast[i]) - flatlast.begin();
+    return std::pair<PartIterator,PartIterator>(PartIterator(flatpart[i]),PartIterator(flatIter(j)));
+  }
   AddrRange addrrange(point);
   typename std::multiset<AddrRange>::const_iterator iter1,iter2;
 
@@ -355,6 +438,13 @@ std::pair<typename rangemap<_recordtype>::const_iterator,typename rangemap<_reco
 rangemap<_recordtype>::find(linetype point,const subsorttype &sub1,const subsorttype &sub2) const
 
 {
+  if (useFlat()) {
+    uint4 i = flatLowerBound(point,sub1);
+    if ((i==flatlast.size())||(point < (*flatpart[i]).first))
+      return std::pair<PartIterator,PartIterator>(PartIterator(flatIter(i)),PartIterator(flatIter(i)));
+    uint4 j = flatUpperBound(flatlast[i],sub2);
+    return std::pair<PartIterator,PartIterator>(PartIterator(flatpart[i]),PartIterator(flatIter(j)));
+  }
   AddrRange addrrange(point,sub1);
   typename std::multiset<AddrRange>::const_iterator iter1,iter2;
 
@@ -375,6 +465,8 @@ typename rangemap<_recordtype>::const_iterator
 rangemap<_recordtype>::find_begin(linetype point) const
 
 {
+  if (useFlat())
+    return flatIter(std::lower_bound(flatlast.begin(),flatlast.end(),point) - flatlast.begin());
   AddrRange addrrange(point);
   typename std::multiset<AddrRange>::const_iterator iter;
 
@@ -389,6 +481,12 @@ typename rangemap<_recordtype>::const_iterator
 rangemap<_recordtype>::find_end(linetype point) const
 
 {
+  if (useFlat()) {
+    uint4 i = std::upper_bound(flatlast.begin(),flatlast.end(),point) - flatlast.begin();
+    if ((i==flatlast.size())||(point < (*flatpart[i]).first))
+      return flatIter(i);
+    return flatIter(std::upper_bound(flatlast.begin()+i,flatlast.end(),flatlast[i]) - flatlast.begin());
+  }
   AddrRange addrend(point,subsorttype(true));
   typename std::multiset<AddrRange>::const_iterator iter;
 
@@ -411,6 +509,12 @@ typename rangemap<_recordtype>::const_iterator
 rangemap<_recordtype>::find_overlap(linetype point,linetype end) const
 
 {
+  if (useFlat()) {
+    uint4 i = std::lower_bound(flatlast.begin(),flatlast.end(),point) - flatlast.begin();
+    if ((i<flatlast.size())&&((*flatpart[i]).first<=end))
+      return flatpart[i];
+    return tree.end();
+  }
   AddrRange addrrange(point);
   typename std::multiset<AddrRange>::const_iterator iter;
 
@@ -38,6 +38,7 @@ using std::map;
 #include "ida_minimal.hh"
 #include "ida_arch.hh"
 #include "ast.hh"
+#include "callgraph.hh"
 
 stringstream *err_stream;
 
@@ -192,6 +193,8 @@ int idaapi blc_init(void) {
    //already loaded in IDA
 
    arch = new ida_arch(filename, sleigh_id, err_stream);
+   //functions are decompiled over and over as the user works, so reuse recovered switch tables
+   arch->jumpcache->setEnabled(true);
 
    DocumentStorage store;  // temporary storage for xml docs
 
@@ -223,10 +226,16 @@ int idaapi blc_init(void) {
 
    msg("Ghidra architecture successfully created\n");
 
+   //no-return flags were imported in bulk by ida_arch::postSpecFile, follow later changes
+   hook_idb_events();
+
    return PLUGIN_KEEP;
 }
 
 void idaapi blc_term(void) {
+   if (arch != NULL) {
+      unhook_idb_events();
+   }
    shutdownDecompilerLibrary();
 
 //   GhidraCapability::shutDown();
@@ -237,6 +246,23 @@ void idaapi blc_term(void) {
 // Extract the info that the decompiler needs to instantiate its address space manager
 // This also builds the internal register map while it walks the sleigh spec.
 
+//clear any old analysis of fd and apply the per-processor setup for the function
+static void prepare_analysis(Funcdata *fd, uint64_t start_ea, uint64_t end_ea) {
+   if (strncmp("ARM", sleigh_id.c_str(), 3) == 0) {
+      //if ARM check for and set thumb ranges
+      if (is_thumb_mode(start_ea)) {
+         arch->context->setVariable("TMode", fd->getAddress(), 1);
+      }
+   }
+
+   arch->clearAnalysis(fd); // Clear any old analysis
+
+   arch_map_t::iterator setup = arch_map.find(get_proc_id());
+   if (setup != arch_map.end()) {
+      (*setup->second)(start_ea, end_ea);
+   }
+}
+
 // see IfcDecompile::execute
 int do_decompile(uint64_t start_ea, uint64_t end_ea, Function **result) {
    Scope *global = arch->symboltab->getGlobalScope();
@@ -244,13 +270,6 @@ int do_decompile(uint64_t start_ea, uint64_t end_ea, Function **result) {
    Funcdata *fd = global->findFunction(addr);
    *result = NULL;
 
-   if (strncmp("ARM", sleigh_id.c_str(), 3) == 0) {
-      //if ARM check for and set thumb ranges
-      if (is_thumb_mode(start_ea)) {
-         arch->context->setVariable("TMode", addr, 1);
-      }
-   }
-
    int4 res = -1;
    if (fd) {
       string xml;
@@ -261,22 +280,29 @@ int do_decompile(uint64_t start_ea, uint64_t end_ea, Function **result) {
 
 //      msg("Decompiling %s\n", func_name.c_str());
 
-      arch->clearAnalysis(fd); // Clear any old analysis
-
-      arch_map_t::iterator setup = arch_map.find(get_proc_id());
-      if (setup != arch_map.end()) {
-         (*setup->second)(start_ea, end_ea);
-      }
+      prepare_analysis(fd, start_ea, end_ea);
 
       arch->allacts.getCurrent()->reset(*fd);
 
-      res = arch->allacts.getCurrent()->perform(*fd);
+      try {
+         res = arch->allacts.getCurrent()->perform(*fd);
+      } catch(...) {
+         //a function left started but not complete is never evicted by the AnalysisLru
+         arch->clearAnalysis(fd);
+         throw;
+      }
+
+      if (res >= 0) {
+         //callers decompiled later can reuse the recovered prototype
+         arch->protocache->store(*fd);
+      }
 
       if (res < 0) {
          ostringstream os;
 //         msg("Break at ");
          arch->allacts.getCurrent()->printState(os);
          msg("%s\n", os.str().c_str());
+         arch->clearAnalysis(fd);
       }
       else {
 //         msg("Decompilation complete");
@@ -305,7 +331,12 @@ int do_decompile(uint64_t start_ea, uint64_t end_ea, Function **result) {
             dump_el(doc->getRoot(), 0, pretty);
 //            msg("%s\n", pretty.c_str());
 
-            *result = func_from_xml(doc->getRoot(), start_ea);
+            //let the ast map op references back to instruction addresses
+            map<uint32_t, uint64_t> op_addrs;
+            for (list<PcodeOp *>::const_iterator oi = fd->beginOpAlive(); oi != fd->endOpAlive(); oi++) {
+               op_addrs[(*oi)->getTime()] = (*oi)->getAddr().getOffset();
+            }
+            *result = func_from_xml(doc->getRoot(), start_ea, &op_addrs);
 //            msg("%s\n", c_code.c_str());
             delete doc;
          }
@@ -318,3 +349,183 @@ int do_decompile(uint64_t start_ea, uint64_t end_ea, Function **result) {
    return res;
 }
 
+//IDA's no-return analysis changed for the function at ea
+void update_noreturn(uint64_t ea, bool noreturn) {
+   if (arch == NULL) {
+      return;
+   }
+   arch->setNoReturn(ea, noreturn);
+}
+
+//functions whose prototype recovery failed, not retried until they change in IDA
+static set<uint64_t> failed_protos;
+
+void invalidate_function(uint64_t ea) {
+   if (arch == NULL) {
+      return;
+   }
+   Address addr(arch->getDefaultSpace(), ea);
+   arch->jumpcache->eraseFunction(addr);
+   arch->protocache->erase(addr);
+   failed_protos.erase(ea);
+}
+
+void invalidate_data(uint64_t ea) {
+   if (arch == NULL) {
+      return;
+   }
+   arch->jumpcache->eraseData(Address(arch->getDefaultSpace(), ea));
+}
+
+void invalidate_all() {
+   if (arch == NULL) {
+      return;
+   }
+   arch->jumpcache->clear();
+   arch->protocache->newPass();
+   failed_protos.clear();
+}
+
+void new_analysis_pass() {
+   if (arch == NULL) {
+      return;
+   }
+   arch->protocache->newPass();
+}
+
+//see the "paramid" root in ActionDatabase::universalAction. This is flow, heritage and
+//parameter recovery without the rest of simplification, enough to cache a prototype
+int recover_prototype(uint64_t start_ea, uint64_t end_ea) {
+   Scope *global = arch->symboltab->getGlobalScope();
+   Address addr(arch->getDefaultSpace(), start_ea);
+   Funcdata *fd = global->findFunction(addr);
+   if (fd == NULL) {
+      return -1;
+   }
+   if (fd->getFuncProto().isInputLocked() || arch->protocache->find(*fd) != NULL) {
+      return 0;
+   }
+   if (failed_protos.find(start_ea) != failed_protos.end()) {
+      return -1;
+   }
+
+   string root = arch->allacts.getCurrentName();
+   int4 res = -1;
+   try {
+      prepare_analysis(fd, start_ea, end_ea);
+      Action *paramid = arch->allacts.setCurrent("paramid");
+      paramid->reset(*fd);
+      res = paramid->perform(*fd);
+      if (res >= 0) {
+         arch->protocache->store(*fd);
+      }
+   } catch(LowlevelError &err) {
+      *err_stream << err.explain << endl;
+   } catch(...) {
+      //anything else is passed on, but later decompiles must not be left running paramid
+      arch->clearAnalysis(fd);
+      arch->allacts.setCurrent(root);
+      throw;
+   }
+   if (res < 0) {
+      failed_protos.insert(start_ea);
+   }
+   arch->clearAnalysis(fd);   //the full decompile starts from scratch anyway
+   arch->allacts.setCurrent(root);
+   check_err_stream();
+   return res;
+}
+
+//recovered types and global variables. Types are only known once the functions using
+//them have been decompiled, so this is emitted after the functions of an export
+void export_header(ostream &out) {
+   arch->print->setOutputStream(&out);
+   try {
+      arch->print->docTypeDefinitions(arch->types);
+      arch->print->docAllGlobals();
+   } catch(LowlevelError &err) {
+      out << "/* " << err.explain << " */" << endl;
+   }
+   arch->print->setOutputStream(NULL);
+   check_err_stream();
+}
+
+//decompile one function and print its C straight to out. Nothing is kept for
+//the function afterwards, its analysis is cleared as soon as it has been printed
+int export_function(uint64_t start_ea, uint64_t end_ea, ostream &out) {
+   Scope *global = arch->symboltab->getGlobalScope();
+   Address addr(arch->getDefaultSpace(), start_ea);
+   Funcdata *fd = global->findFunction(addr);
+   if (fd == NULL) {
+      return -1;
+   }
+   int4 res = -1;
+   string error;
+   try {
+      prepare_analysis(fd, start_ea, end_ea);
+      arch->allacts.getCurrent()->reset(*fd);
+      res = arch->allacts.getCurrent()->perform(*fd);
+      if (res >= 0) {
+         arch->protocache->store(*fd);
+         arch->print->setIndentIncrement(3);
+         arch->print->setOutputStream(&out);
+         arch->print->docFunction(fd);
+      }
+      else {
+         out << "/* " << fd->getName() << ": decompilation incomplete */" << endl;
+      }
+   } catch(LowlevelError &err) {
+      error = err.explain;
+   } catch(XmlError &err) {
+      error = err.explain;
+      *err_stream << fd->getName() << ": " << error << endl;
+   } catch(std::exception &err) {
+      //anything else must not end an export that may have run for hours
+      error = err.what();
+      *err_stream << fd->getName() << ": " << error << endl;
+   } catch(...) {
+      error = "unknown exception";
+      *err_stream << fd->getName() << ": " << error << endl;
+   }
+   if (!error.empty()) {
+      out << "/* " << fd->getName() << ": " << error << " */" << endl;
+      arch->print->clear();   //drop the half printed function so the next starts clean
+      res = -1;
+   }
+   arch->print->setOutputStream(NULL);
+   arch->clearAnalysis(fd);
+   check_err_stream();
+   return res;
+}
+
+void schedule_bottom_up(const vector<uint64_t> &funcs, const vector<CallSite> &calls,
+                        vector<vector<uint64_t> > &batches) {
+   CallGraph cg(arch);
+   AddrSpace *spc = arch->getDefaultSpace();
+   for (vector<uint64_t>::const_iterator fi = funcs.begin(); fi != funcs.end(); fi++) {
+      string name;
+      get_func_name(name, *fi);
+      cg.addNode(Address(spc, *fi), name);
+   }
+   for (vector<CallSite>::const_iterator ci = calls.begin(); ci != calls.end(); ci++) {
+      CallGraphNode *from = cg.findNode(Address(spc, ci->from));
+      CallGraphNode *to = cg.findNode(Address(spc, ci->to));
+      if (from && to) {
+         cg.addEdge(from, to, Address(spc, ci->site));
+      }
+   }
+
+   vector<vector<CallGraphNode *> > comps;
+   vector<int4> level;
+   cg.buildComponents(comps, level);
+
+   batches.clear();
+   for (size_t i = 0; i < comps.size(); i++) {
+      if ((size_t)level[i] >= batches.size()) {
+         batches.resize(level[i] + 1);
+      }
+      for (vector<CallGraphNode *>::iterator ni = comps[i].begin(); ni != comps[i].end(); ni++) {
+         batches[level[i]].push_back((*ni)->getAddr().getOffset());
+      }
+   }
+}
@@ -121,11 +121,10 @@ void PcodeCacher::resolveRelatives(void)
 
 void PcodeCacher::emit(const Address &addr,PcodeEmit *emt) const
 
-{ // Emit any cached pcode
-  vector<PcodeData>::const_iterator iter;
-
-  for(iter=issued.begin();iter!=issued.end();++iter)
-    emt->dump(addr,(*iter).opc,(*iter).outvar,(*iter).invar,(*iter).isize);
+{ // Emit any cached pcode as a single block, handing over the
+  // issued array and the varnode pool directly without copying
+  if (issued.empty()) return;
+  emt->dumpBlock(addr,&issued[0],issued.size());
 }
 
 void SleighBuilder::generateLocation(const VarnodeTpl *vntpl,VarnodeData &vn)
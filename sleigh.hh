@@ -25,13 +25,6 @@ struct RelativeRecord {
   uintb calling_index;		// Index of instruction containing relative offset
 };
 
-struct PcodeData { // Data for building one pcode instruction
-  OpCode opc;
-  VarnodeData *outvar;	     // Points to outvar is there is an output
-  VarnodeData *invar;		// Inputs
-  int4 isize;			// Number of inputs
-};
-
 class PcodeCacher { // Cached chunk of pcode, prior to emitting
   VarnodeData *poolstart;
   VarnodeData *curpool;
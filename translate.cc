@@ -750,6 +750,16 @@ const FloatFormat *Translate::getFloatFormat(int4 size) const
   return (const FloatFormat *)0;
 }
 
+/// \param addr is the Address of the machine instruction
+/// \param ops is the contiguous array of p-code ops
+/// \param numops is the number of ops
+void PcodeEmit::dumpBlock(const Address &addr,const PcodeData *ops,int4 numops)
+
+{
+  for(int4 i=0;i<numops;++i)
+    dump(addr,ops[i].opc,ops[i].outvar,ops[i].invar,ops[i].isize);
+}
+
 /// A convenience method for passing around pcode operations via
 /// XML.  A single pcode operation is parsed from an XML tag and
 /// returned to the application via the PcodeEmit::dump method.
@@ -69,6 +69,17 @@ public:
   uint4 getSize(void) const { return size; }			///< Size (of pointers) for new truncated space
 };
 
+/// \brief Raw data for a single p-code op within an emitted instruction block
+///
+/// The VarnodeData referenced by \b outvar and \b invar are owned by the translation
+/// engine and are only valid for the duration of the emit call.
+struct PcodeData {
+  OpCode opc;			///< The op-code
+  VarnodeData *outvar;		///< Output varnode, or \e null if there is no output
+  VarnodeData *invar;		///< Array of input varnodes
+  int4 isize;			///< Number of inputs
+};
+
 /// \brief Abstract class for emitting pcode to an application
 ///
 /// Translation engines pass back the generated pcode for an
@@ -91,6 +102,16 @@ public:
   /// \param isize is the number of input varnodes
   virtual void dump(const Address &addr,OpCode opc,VarnodeData *outvar,VarnodeData *vars,int4 isize)=0;
 
+  /// \brief Emit all the p-code for a single machine instruction at once
+  ///
+  /// The translation engine hands over its fully resolved op array without copying.
+  /// The default implementation passes each op to dump() in turn. Applications
+  /// that can amortize work across the whole instruction should override this.
+  /// \param addr is the Address of the machine instruction
+  /// \param ops is the contiguous array of p-code ops making up the instruction
+  /// \param numops is the number of ops in the array
+  virtual void dumpBlock(const Address &addr,const PcodeData *ops,int4 numops);
+
   /// Emit pcode directly from an XML tag
   void restoreXmlOp(const Element *el,const AddrSpaceManager *trans);
 
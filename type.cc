@@ -123,6 +123,19 @@ int4 Datatype::compareDependency(const Datatype &op) const
   return 0;
 }
 
+/// Hash the same properties examined by compareDependency(), so that any two data-types
+/// that compare as equal produce the same hash.  Derived classes that compare additional
+/// fields may mix them into the hash.
+/// \return the hash value
+uint4 Datatype::hashDependency(void) const
+
+{
+  uint4 res = (uint4)size;
+  res = res * 0x9e3779b1 + (uint4)metatype;
+  res = res * 0x9e3779b1 + (flags & (~coretype));
+  return res;
+}
+
 /// Convert a type \b meta-type into the string name of the meta-type
 /// \param metatype is the encoded type meta-type
 /// \param res will hold the resulting string
@@ -416,6 +429,17 @@ int4 TypePointer::compareDependency(const Datatype &op) const
   return (ptrto < tp->ptrto) ? -1 : 1; // Compare the absolute pointers
 }
 
+uint4 TypePointer::hashDependency(void) const
+
+{
+  uint4 res = Datatype::hashDependency();
+  res = res * 0x9e3779b1 + wordsize;
+  uintp val = (uintp)ptrto;	// Pointed-to type is compared by address
+  res = res * 0x9e3779b1 + (uint4)val;
+  res = res * 0x9e3779b1 + (uint4)(val >> 16 >> 16);
+  return res;
+}
+
 void TypePointer::saveXml(ostream &s) const
 
 {
@@ -478,6 +502,16 @@ int4 TypeArray::compareDependency(const Datatype &op) const
   return (arrayof < ta->arrayof) ? -1 : 1;
 }
 
+uint4 TypeArray::hashDependency(void) const
+
+{
+  uint4 res = Datatype::hashDependency();
+  uintp val = (uintp)arrayof;	// Element type is compared by address
+  res = res * 0x9e3779b1 + (uint4)val;
+  res = res * 0x9e3779b1 + (uint4)(val >> 16 >> 16);
+  return res;
+}
+
 Datatype *TypeArray::getSubType(uintb off,uintb *newoff) const
 
 {				// Go down exactly one level, to type of element
@@ -1331,6 +1365,7 @@ void TypeFactory::clear(void)
     delete *iter;
   tree.clear();
   nametree.clear();
+  hashtree.clear();
   clearCache();
 }
 
@@ -1349,6 +1384,7 @@ void TypeFactory::clearNoncore(void)
       continue;
     }
     nametree.erase(ct);
+    hashtree.erase(ct);
     tree.erase(iter++);
     delete ct;
   }
@@ -1403,6 +1439,31 @@ Datatype *TypeFactory::findByName(const string &n)
   return findById(n,0);
 }
 
+/// Anonymous pointers, arrays, and atomic data-types are built constantly during type
+/// propagation. These are kept in a hash index in addition to the main tree, so they can
+/// be looked up without a tree walk.  Their description never changes once they are
+/// in the container, so their hash is stable.
+/// \param ct is the data-type to test
+/// \return \b true if the data-type belongs in the hash index
+bool TypeFactory::isHashConsed(const Datatype &ct)
+
+{
+  if (ct.id != 0) return false;
+  switch(ct.metatype) {
+  case TYPE_PTR:
+  case TYPE_ARRAY:
+  case TYPE_FLOAT:
+  case TYPE_BOOL:
+  case TYPE_UINT:
+  case TYPE_INT:
+  case TYPE_UNKNOWN:
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
 /// Find data-type without reference to name, using the functional comparators
 /// For this to work, the type must be built out of dependencies that are already
 /// present in \b this type factory
@@ -1411,6 +1472,12 @@ Datatype *TypeFactory::findByName(const string &n)
 Datatype *TypeFactory::findNoName(Datatype &ct)
 
 {
+  if (isHashConsed(ct)) {
+    DatatypeHashSet::const_iterator hiter = hashtree.find(&ct);
+    if (hiter != hashtree.end())
+      return *hiter;
+    return (Datatype *)0;
+  }
   DatatypeSet::const_iterator iter;
   Datatype *res = (Datatype *)0;
   iter = tree.find(&ct);
@@ -1456,6 +1523,8 @@ Datatype *TypeFactory::findAdd(Datatype &ct)
   }
   if (newtype->id!=0)
     nametree.insert(newtype);
+  else if (isHashConsed(*newtype))
+    hashtree.insert(newtype);
   return newtype;
 }
   
@@ -1468,6 +1537,8 @@ Datatype *TypeFactory::setName(Datatype *ct,const string &n)
 {
   if (ct->id != 0)
     nametree.erase( ct );	// Erase any name reference
+  else
+    hashtree.erase( ct );	// Named types are not hash-consed
   tree.erase(ct);		// Remove new type completely from trees
   ct->name = n;			// Change the name
   if (ct->id == 0)
@@ -1871,6 +1942,7 @@ void TypeFactory::destroyType(Datatype *ct)
   if (ct->isCoreType())
     throw LowlevelError("Cannot destroy core type");
   nametree.erase(ct);
+  hashtree.erase(ct);
   tree.erase(ct);
   delete ct;
 }
@@ -20,6 +20,7 @@
 #define __CPUI_TYPE__
 
 #include "address.hh"
+#include <unordered_set>
 
 /// Print a hex dump of a data buffer to stream
 extern void print_data(ostream &s,uint1 *buffer,int4 size,const Address &baseaddr);
@@ -112,6 +113,7 @@ public:
   virtual void printNameBase(ostream &s) const { if (!name.empty()) s<<name[0]; } ///< Print name as short prefix
   virtual int4 compare(const Datatype &op,int4 level) const; ///< Compare for functional equivalence
   virtual int4 compareDependency(const Datatype &op) const; ///< Compare for storage in tree structure
+  virtual uint4 hashDependency(void) const;	///< Hash consistent with compareDependency()
   virtual Datatype *clone(void) const=0;	///< Clone the data-type
   virtual void saveXml(ostream &s) const;	///< Serialize the data-type to XML
   int4 typeOrder(const Datatype &op) const { if (this==&op) return 0; return compare(op,10); }	///< Order this with -op- datatype
@@ -145,9 +147,26 @@ struct DatatypeNameCompare {
     return a->getId() < b->getId(); }
 };
 
+/// Hash a Datatype pointer by its description, consistent with DatatypeCompare
+struct DatatypeHash {
+  /// Hash operator
+  size_t operator()(const Datatype *a) const { return a->hashDependency(); }
+};
+
+/// Compare two Datatype pointers for equality of their description
+struct DatatypeEqual {
+  /// Equality operator
+  bool operator()(const Datatype *a,const Datatype *b) const {
+    if (a->getId() != b->getId()) return false;
+    return (a->compareDependency(*b) == 0); }
+};
+
 /// A set of data-types sorted by function
 typedef set<Datatype *,DatatypeCompare> DatatypeSet;
 
+/// A hash-consed set of anonymous data-types
+typedef unordered_set<Datatype *,DatatypeHash,DatatypeEqual> DatatypeHashSet;
+
 /// A set of data-types sorted by name
 typedef set<Datatype *,DatatypeNameCompare> DatatypeNameSet;
 
@@ -236,6 +255,7 @@ public:
   virtual void printNameBase(ostream &s) const { s << 'p'; ptrto->printNameBase(s); }
   virtual int4 compare(const Datatype &op,int4 level) const; // For tree structure
   virtual int4 compareDependency(const Datatype &op) const; // For tree structure
+  virtual uint4 hashDependency(void) const;
   virtual Datatype *clone(void) const { return new TypePointer(*this); }
   virtual void saveXml(ostream &s) const;
 };
@@ -265,6 +285,7 @@ public:
   virtual void printNameBase(ostream &s) const { s << 'a'; arrayof->printNameBase(s); }
   virtual int4 compare(const Datatype &op,int4 level) const; // For tree structure
   virtual int4 compareDependency(const Datatype &op) const; // For tree structure
+  virtual uint4 hashDependency(void) const;
   virtual Datatype *clone(void) const { return new TypeArray(*this); }
   virtual void saveXml(ostream &s) const;
 };
@@ -383,10 +404,12 @@ class TypeFactory {
   type_metatype enumtype;	///< Default enumeration meta-type (when parsing C)
   DatatypeSet tree;		///< Datatypes within this factory (sorted by function)
   DatatypeNameSet nametree;	///< Cross-reference by name
+  DatatypeHashSet hashtree;	///< Hash-consed index of anonymous atomic, pointer, and array data-types
   Datatype *typecache[9][8];	///< Matrix of the most common atomic data-types
   Datatype *typecache10;	///< Specially cached 10-byte float type
   Datatype *typecache16;	///< Specially cached 16-byte float type
   Datatype *type_nochar;	///< Same dimensions as char but acts and displays as an INT
+  static bool isHashConsed(const Datatype &ct);	///< Is the given data-type indexed by hash
   Datatype *findNoName(Datatype &ct);	///< Find data-type (in this container) by function
   Datatype *findAdd(Datatype &ct);	///< Find data-type in this container or add it
   void orderRecurse(vector<Datatype *> &deporder,DatatypeSet &mark,Datatype *ct) const;	///< Write out dependency list
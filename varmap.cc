@@ -1281,6 +1281,7 @@ void ScopeLocal::makeNameRecommendationsForSymbols(vector<string> &resname,vecto
 
   list<DynamicRecommend>::const_iterator dyniter;
   DynamicHash dhash;
+  dhash.setIndexing(true);
   for(dyniter=dynRecommend.begin();dyniter!=dynRecommend.end();++dyniter) {
     dhash.clear();
     const DynamicRecommend &dynEntry(*dyniter);